@@ -3,6 +3,13 @@
 #include "RectangleReasoning.h"
 #include "CorridorReasoning.h"
 #include "MutexReasoning.h"
+#include "OccupancyIndex.h"
+#include "MoveInterference.h"
+#include <mutex>
+#include <functional>
+#include <chrono>
+#include <atomic>
+#include <random>
 
 enum high_level_solver_type { ASTAR, ASTAREPS, NEW, EES };
 
@@ -20,6 +27,7 @@ public:
 	double runtime_path_finding = 0; // runtime of finding paths for single agents
 	double runtime_detect_conflicts = 0;
 	double runtime_preprocessing = 0; // runtime of building heuristic table for the low level
+	double runtime_generate_root = 0; // wall-clock runtime of generating the root
 
 	uint64_t num_cardinal_conflicts = 0;
 	uint64_t num_corridor_conflicts = 0;
@@ -29,6 +37,14 @@ public:
 	uint64_t num_standard_conflicts = 0;
 
 	uint64_t num_adopt_bypass = 0; // number of times when adopting bypasses
+	uint64_t num_root_conflicts = 0;
+	uint64_t num_root_waves = 0; // number of waves the root was planned in (0: one agent after another)
+	uint64_t num_retired = 0; // number of CT nodes whose paths were dropped to stay within the memory limit
+	uint64_t num_regenerated = 0; // number of retired CT nodes whose paths were found again
+	uint64_t num_merges = 0; // number of pairs of meta-agents merged
+	uint64_t num_heuristic_cache_hits = 0; // lifelong: number of new goals whose heuristic table was cached
+	uint64_t num_heuristic_cache_misses = 0; // lifelong: number of new goals whose heuristic table was computed
+	uint64_t num_heuristic_cache_evictions = 0; // lifelong: number of heuristic tables released to stay within the limit
 
 	uint64_t num_HL_expanded = 0;
 	uint64_t num_HL_generated = 0;
@@ -47,6 +63,12 @@ public:
 
 	bool solution_found = false;
 	int solution_cost = -2;
+	bool best_effort_plan = false; // the paths are the plan with the fewest conflicts of a search that ran out of time
+	uint64_t num_remaining_conflicts = 0; // the conflicts of the best-effort plan
+
+	// portfolio racing (see --portfolio)
+	string portfolio_config = "none"; // the configuration of this solver in the portfolio
+	bool portfolio_win = false; // this solver found the solution first
 
 	/////////////////////////////////////////////////////////////////////////////////////////
 	// set params
@@ -71,6 +93,12 @@ public:
 		suboptimality = w;
 	}
 	void setNodeLimit(int n) { node_limit = n; }
+	void setMDDMemoryLimit(int mb) { mdd_helper.setMemoryLimit(mb); }
+	void setHeuristicCacheLimit(int mb) { heuristic_cache_limit = (size_t)mb * 1024 * 1024; }
+	void setNumOfThreads(int n) { num_of_threads = n; }
+	void setSeed(int seed) { rng.seed(seed); } // used for the random order of the agents in the root
+	void setCancelFlag(const std::atomic<bool>* flag) { cancel_flag = flag; }
+	void setWindow(int w) { window = w > 0 ? w : MAX_TIMESTEP; heuristic_helper.window = window; } // 0: no window
 
 	////////////////////////////////////////////////////////////////////////////////////////////
 	// Runs the algorithm until the problem is solved or time is exhausted 
@@ -78,7 +106,19 @@ public:
 
 	int getLowerBound() const { return cost_lowerbound; }
 
-	CBS(const Instance& instance, bool sipp, int screen);
+	// lifelong MAPF: give the agents new starts, with the headings they arrived with, and goals, keeping the search
+	// engines, and cache the heuristic tables of the goals
+	void setTasks(const vector<PathEntry>& starts, const vector<int>& goals);
+	int getStartLocation(int agent) const { return search_engines[agent]->start_location; }
+	int getGoalLocation(int agent) const { return search_engines[agent]->goal_location; }
+	const Path& getPath(int agent) const { return *paths[agent]; }
+	const SingleAgentSolver& getSearchEngine(int agent) const { return *search_engines[agent]; }
+
+	static void parallelFor(size_t n, int threads, const std::function<void(size_t)>& task); // run task(0..n-1) on up to so many threads
+
+	// copies the low-level heuristic tables of heuristic_source, of its agents source_agents (empty: the same agents)
+	CBS(const Instance& instance, bool sipp, int screen, const CBS* heuristic_source = nullptr,
+		const vector<int>& source_agents = vector<int>());
 	CBS(vector<SingleAgentSolver*>& search_engines,
 		const vector<ConstraintTable>& constraints,
 		vector<Path>& paths_found_initially, int screen);
@@ -89,7 +129,8 @@ public:
 	void saveResults(const string &fileName, const string &instanceName) const;
 	void saveStats(const string &fileName, const string &instanceName);
 	void saveCT(const string &fileName) const; // write the CT to a file
-    void savePaths(const string &fileName) const; // write the paths to a file
+    void savePaths(const string &fileName, // write the paths to a file, marking the agents of the conflicts
+		const list<shared_ptr<Conflict>>& conflicts = list<shared_ptr<Conflict>>()) const;
 	void clear(); // used for rapid random  restart
 
 	int getInitialPathLength(int agent) const {return (int) paths_found_initially[agent].size() - 1; }
@@ -97,6 +138,7 @@ protected:
     bool rectangle_reasoning;  // using rectangle reasoning
 	bool corridor_reasoning;  // using corridor reasoning
 	bool target_reasoning;  // using target reasoning
+	int window = MAX_TIMESTEP; // rolling horizon: only the conflicts before this timestep are resolved
 	bool disjoint_splitting;  // disjoint splitting
 	bool mutex_reasoning;  // using mutex reasoning
 	bool bypass; // using Bypass1
@@ -113,6 +155,7 @@ protected:
 	CBSHeuristic heuristic_helper;
 
 	list<HLNode*> allNodes_table; // this is ued for both ECBS and EES
+	NodeArena node_arena; // owns the CT nodes
 
 
 	string getSolverName() const;
@@ -127,28 +170,54 @@ protected:
 	int cost_upperbound = MAX_COST;
 
 	vector<ConstraintTable> initial_constraints;
-	clock_t start;
+	std::chrono::steady_clock::time_point start; // wall clock, as the search may run on several threads
+	double getRuntime() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); }
 
 	int num_of_agents;
+	mutable std::mt19937 rng;
+	const std::atomic<bool>* cancel_flag = nullptr; // set by another thread to stop the search
+	int num_of_threads = 1; // >1 means the two children of a CT node, and the agents replanned in a child, are replanned in parallel
+	std::mutex stats_mutex; // guards the low-level stats while the children are generated in parallel
+
+	struct ChildPaths // the paths of a child CT node that is replanned in parallel with its sibling
+	{
+		vector<Path*> paths;
+		vector<int> min_f_vals; // ECBS only
+		bool solved = false;
+	};
+	bool getChildrenAgents(const HLNode* child1, const HLNode* child2, set<int> agents[2]); // false if they share agents
 
 
 	vector<Path*> paths;
 	vector<Path> paths_found_initially;  // contain initial paths found
+	mutable OccupancyIndex occupancy; // the cells visited by paths, synced with paths before each use
+	struct CachedHeuristic
+	{
+		vector<int> table;
+		list<int>::iterator lru_handle; // position in heuristic_lru
+	};
+	unordered_map<int, CachedHeuristic> heuristic_cache; // lifelong: goal location -> heuristic table
+	list<int> heuristic_lru; // goal locations of the cached tables, most recently used first
+	size_t heuristic_cache_limit = (size_t)256 * 1024 * 1024; // in bytes
+	size_t heuristic_cache_bytes = 0;
+	void cacheHeuristic(int goal, vector<int>&& table); // evict the least recently used tables beyond the limit
 	// vector<MDD*> mdds_initially;  // contain initial paths found
 	vector < SingleAgentSolver* > search_engines;  // used to find (single) agents' paths and mdd
 
 	void addConstraints(const HLNode* curr, HLNode* child1, HLNode* child2) const;
-	set<int> getInvalidAgents(const list<Constraint>& constraints); // return agents that violate the constraints
+	set<int> getInvalidAgents(const ConstraintList& constraints); // return agents that violate the constraints
 	//conflicts
 	void findConflicts(HLNode& curr);
+	void findAllConflicts(HLNode& curr); // check all pairs of agents instead of starting from the conflicts of the parent
 	void findConflicts(HLNode& curr, int a1, int a2);
 	shared_ptr<Conflict> chooseConflict(const HLNode &node) const;
 	static void copyConflicts(const list<shared_ptr<Conflict>>& conflicts,
 		list<shared_ptr<Conflict>>& copy, const list<int>& excluded_agent) ;
-	void removeLowPriorityConflicts(list<shared_ptr<Conflict>>& conflicts) const;
+	void removeLowPriorityConflicts(ConflictSet& conflicts) const;
 	void computeSecondPriorityForConflict(Conflict& conflict, const HLNode& node);
 
 	inline void releaseNodes();
+	void discardNode(HLNode* node); // destroy a CT node that is not in allNodes_table
 
 	// print and save
 	void printResults() const;
@@ -158,7 +227,7 @@ protected:
 	inline int getAgentLocation(int agent_id, size_t timestep) const;
 
 	vector<int> shuffleAgents() const;  //generate random permutation of agent indices
-	bool terminate(HLNode* curr); // check the stop condition and return true if it meets
+	bool terminate(HLNode* curr, bool anytime = false); // check the stop condition and return true if it meets; anytime: a solution within the bound does not stop the search
 	void computeConflictPriority(shared_ptr<Conflict>& con, CBSNode& node); // check the conflict is cardinal, semi-cardinal or non-cardinal
 
 
@@ -174,8 +243,13 @@ private: // CBS only, cannot be used by ECBS
 
 		 // high level search
 	bool generateChild(CBSNode* child, CBSNode* curr);
+	void initChild(CBSNode* child, CBSNode* curr);
+	bool replanChildren(CBSNode* child[2], CBSNode* curr, ChildPaths rst[2]); // generate the paths of both children in parallel
+	bool finishChild(CBSNode* child, ChildPaths& child_paths); // detect conflicts and compute h once the paths are found
 	bool generateRoot();
-	bool findPathForSingleAgent(CBSNode*  node, int ag, int lower_bound = 0);
+	Path searchPath(const CBSNode* node, int ag, int lower_bound, const vector<Path*>& child_paths); // the low-level search only
+	void addPath(CBSNode* node, int ag, const Path& new_path, vector<Path*>& child_paths);
+	bool replanAgents(CBSNode* node, const set<int>& agents, vector<Path*>& child_paths, int threads);
 	void classifyConflicts(CBSNode &parent);
 		 //update information
 	inline void updatePaths(CBSNode* curr);
@@ -11,67 +11,24 @@ struct HTableEntry // look-up table entry
 	int a1{};
 	int a2{};
 	HLNode* n{};
+	ConstraintFingerprint fp1, fp2;
 
 	HTableEntry() = default;
-	HTableEntry(int a1, int a2, HLNode* n) : a1(a1), a2(a2), n(n) {};
+	HTableEntry(int a1, int a2, HLNode* n) : a1(a1), a2(a2), n(n),
+		fp1(n->getFingerprint(a1)), fp2(n->getFingerprint(a2)) {};
 
 	struct EqNode
 	{
 		bool operator() (const HTableEntry& h1, const HTableEntry& h2) const
 		{
-			std::set<Constraint> cons1[2], cons2[2];
-			auto curr = h1.n;
-			while (curr->parent != nullptr)
-			{
-				if (get<4>(curr->constraints.front()) == constraint_type::LEQLENGTH ||
-					get<4>(curr->constraints.front()) == constraint_type::POSITIVE_VERTEX ||
-					get<4>(curr->constraints.front()) == constraint_type::POSITIVE_EDGE) {
-					for (auto con : curr->constraints)
-					{
-						cons1[0].insert(con);
-						cons2[0].insert(con);
-					}
-				}
-				else {
-					if (get<0>(curr->constraints.front()) == h1.a1)
-						for (auto con : curr->constraints)
-							cons1[0].insert(con);
-					else if (get<0>(curr->constraints.front()) == h1.a2)
-						for (auto con : curr->constraints)
-							cons2[0].insert(con);
-				}
-
-				curr = curr->parent;
-			}
-			curr = h2.n;
-			while (curr->parent != nullptr)
-			{
-				if (get<4>(curr->constraints.front()) == constraint_type::LEQLENGTH ||
-					get<4>(curr->constraints.front()) == constraint_type::POSITIVE_VERTEX ||
-					get<4>(curr->constraints.front()) == constraint_type::POSITIVE_EDGE) {
-					for (auto con : curr->constraints)
-					{
-						cons1[1].insert(con);
-						cons2[1].insert(con);
-					}
-				}
-				else {
-					if (get<0>(curr->constraints.front()) == h2.a1)
-						for (auto con : curr->constraints)
-							cons1[1].insert(con);
-					else if (get<0>(curr->constraints.front()) == h2.a2)
-						for (auto con : curr->constraints)
-							cons2[1].insert(con);
-				}
-
-				curr = curr->parent;
-			}
-			if (cons1[0].size() != cons1[1].size() || cons2[0].size() != cons2[1].size())
-				return false;
-
-			if (!equal(cons1[0].begin(), cons1[0].end(), cons1[1].begin()))
-				return false;
-			return equal(cons2[0].begin(), cons2[0].end(), cons2[1].begin());
+#ifdef CHECK_CONSTRAINT_FINGERPRINTS
+			bool rst = h1.n->collectConstraints(h1.a1) == h2.n->collectConstraints(h2.a1) &&
+				h1.n->collectConstraints(h1.a2) == h2.n->collectConstraints(h2.a2);
+			assert(rst == (h1.fp1 == h2.fp1 && h1.fp2 == h2.fp2));
+			return rst;
+#else
+			return h1.fp1 == h2.fp1 && h1.fp2 == h2.fp2;
+#endif
 		}
 	};
 
@@ -80,39 +37,7 @@ struct HTableEntry // look-up table entry
 	{
 		size_t operator()(const HTableEntry& entry) const
 		{
-			auto curr = entry.n;
-			size_t cons1_hash = 0, cons2_hash = 0;
-			while (curr->parent != nullptr)
-			{
-				if (get<0>(curr->constraints.front()) == entry.a1 ||
-					get<4>(curr->constraints.front()) == constraint_type::LEQLENGTH ||
-					get<4>(curr->constraints.front()) == constraint_type::POSITIVE_VERTEX ||
-					get<4>(curr->constraints.front()) == constraint_type::POSITIVE_EDGE)
-				{
-					for (auto con : curr->constraints)
-					{
-						cons1_hash += 3 * std::hash<int>()(std::get<0>(con)) +
-							5 * std::hash<int>()(std::get<1>(con)) +
-							7 * std::hash<int>()(std::get<2>(con)) +
-							11 * std::hash<int>()(std::get<3>(con));
-					}
-				}
-				else if (get<0>(curr->constraints.front()) == entry.a2 ||
-					get<4>(curr->constraints.front()) == constraint_type::LEQLENGTH ||
-					get<4>(curr->constraints.front()) == constraint_type::POSITIVE_VERTEX ||
-					get<4>(curr->constraints.front()) == constraint_type::POSITIVE_EDGE)
-				{
-					for (auto con : curr->constraints)
-					{
-						cons2_hash += 3 * std::hash<int>()(std::get<0>(con)) +
-							5 * std::hash<int>()(std::get<1>(con)) +
-							7 * std::hash<int>()(std::get<2>(con)) +
-							11 * std::hash<int>()(std::get<3>(con));
-					}
-				}
-				curr = curr->parent;
-			}
-			return cons1_hash ^ (cons2_hash << 1);
+			return (size_t)(entry.fp1.lo ^ (entry.fp2.lo << 1));
 		}
 	};
 };
@@ -132,6 +57,7 @@ public:
 	bool mutex_reasoning; // using mutex reasoning
 	bool disjoint_splitting; // disjoint splitting
 	bool PC; // prioritize conflicts
+	int window = MAX_TIMESTEP; // only the conflicts before this timestep are resolved
 
 	bool save_stats;
 	conflict_selection conflict_seletion_rule;
@@ -183,6 +109,7 @@ public:
             num_of_errors.assign(1, 0);
         }
     }
+	heuristics_type getInadmissibleHeuristics() const { return inadmissible_heuristic; }
 	bool computeInformedHeuristics(CBSNode& curr, double time_limit);
 	bool computeInformedHeuristics(ECBSNode& curr, const vector<int>& min_f_vals, double time_limit);
 	void computeQuickHeuristics(HLNode& curr);
@@ -197,7 +124,24 @@ public:
 	double getDistanceError(int i = 0) const { return (num_of_errors[i] == 0)? 0 : sum_distance_errors[i]  / num_of_errors[i]; }
 
 	// void copyConflictGraph(HLNode& child, const HLNode& parent);
-	void clear() { lookupTable.clear(); }
+	void clear() { lookupTable.clear(); new_entries.clear(); }
+
+	// checkpointing (ECBS)
+	bool log_new_entries = false; // keep the look-up table entries added until takeNewEntries
+	vector<const HTable::value_type*> takeNewEntries();
+	void restoreEntry(const HTableEntry& entry, const tuple<int, int, int>& value) { lookupTable[entry.a1][entry.a2][entry] = value; }
+	void getOnlineErrors(vector<double>& distance_errors, vector<double>& cost_errors, vector<int>& counts) const
+	{
+		distance_errors = sum_distance_errors;
+		cost_errors = sum_cost_errors;
+		counts = num_of_errors;
+	}
+	void setOnlineErrors(const vector<double>& distance_errors, const vector<double>& cost_errors, const vector<int>& counts)
+	{
+		sum_distance_errors = distance_errors;
+		sum_cost_errors = cost_errors;
+		num_of_errors = counts;
+	}
 
 private:
     heuristics_type inadmissible_heuristic;
@@ -205,6 +149,7 @@ private:
 	int screen = 0;
 	int num_of_agents;
 	vector<vector<HTable> > lookupTable; //num_agents X num_agents table with pairwise conflicts
+	vector<const HTable::value_type*> new_entries; // see log_new_entries (the entries do not move in the table)
 
 	// double sum_distance_error = 0;
 	// double sum_cost_error = 0;
@@ -232,6 +177,7 @@ private:
 	bool buildWeightedDependencyGraph(CBSNode& curr, vector<int>& CG);
 	bool buildWeightedDependencyGraph(ECBSNode& node, const vector<int>& min_f_vals, vector<int>& CG, int& delta_g);
 	bool dependent(int a1, int a2, HLNode& node); // return true if the two agents are dependent
+	void memorize(int a1, int a2, HLNode& node, const tuple<int, int, int>& value); // add to the look-up table
 	pair<int, int> solve2Agents(int a1, int a2, const CBSNode& node, bool cardinal); // return h value and num of CT nodes
     tuple<int, int, int> solve2Agents(int a1, int a2, const ECBSNode& node); // return h value and num of CT nodes
 	static bool SyncMDDs(const MDD &mdd1, const MDD& mdd2); 	// Match and prune MDD according to another MDD.
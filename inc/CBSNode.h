@@ -4,25 +4,174 @@
 
 enum node_selection { NODE_RANDOM, NODE_H, NODE_DEPTH, NODE_CONFLICTS, NODE_CONFLICTPAIRS, NODE_MVC };
 
+// Define CHECK_CONSTRAINT_FINGERPRINTS to compare the full constraint sets in the MDD and heuristic look-up tables
+// (and check them against the fingerprints) instead of trusting the fingerprints alone.
+// #define CHECK_CONSTRAINT_FINGERPRINTS
+
+// Define RECORD_LIST_TOPS to record in every expanded CT node the f, f^ and d values of the best nodes
+// in CLEANUP, OPEN and FOCAL when it was selected (written to the tree file by saveCT).
+// #define RECORD_LIST_TOPS
+
+enum node_source : uint8_t { SOURCE_NONE, SOURCE_CLEANUP, SOURCE_OPEN, SOURCE_FOCAL }; // the list a CT node is chosen from
+
+std::ostream& operator<<(std::ostream& os, node_source source);
+
+// 128-bit order-independent fingerprint of a set of constraints (sum of per-constraint hashes)
+struct ConstraintFingerprint
+{
+	uint64_t lo = 0;
+	uint64_t hi = 0;
+
+	ConstraintFingerprint() = default;
+	explicit ConstraintFingerprint(const Constraint& constraint);
+	ConstraintFingerprint& operator+=(const ConstraintFingerprint& other)
+	{
+		lo += other.lo;
+		hi += other.hi;
+		return *this;
+	}
+	ConstraintFingerprint operator+(const ConstraintFingerprint& other) const
+	{
+		ConstraintFingerprint rst = *this;
+		return rst += other;
+	}
+	bool operator==(const ConstraintFingerprint& other) const { return lo == other.lo && hi == other.hi; }
+	bool operator!=(const ConstraintFingerprint& other) const { return !(*this == other); }
+	bool empty() const { return lo == 0 && hi == 0; }
+};
+
+
+// Per-agent fingerprints stored in a persistent 16-ary trie, so that a child CT node
+// shares everything but the path to the one agent it adds constraints to with its parent.
+class AgentFingerprints
+{
+public:
+	ConstraintFingerprint get(int agent) const;
+	void add(int agent, const ConstraintFingerprint& fp); // copy the path to the agent and add fp to it
+
+private:
+	static const int BRANCHES = 16;
+	struct TrieNode
+	{
+		vector<shared_ptr<const TrieNode> > children; // inner node
+		vector<ConstraintFingerprint> fps; // leaf
+	};
+	shared_ptr<const TrieNode> root;
+	int height = 0; // the trie covers agents [0, 16^(height+1))
+
+	static shared_ptr<const TrieNode> add(const shared_ptr<const TrieNode>& node, int height,
+		int agent, const ConstraintFingerprint& fp);
+};
+
+
+
+// The classified conflicts of a CT node, shared with its ancestors. A set is a chain of layers, each holding
+// the conflicts added in one CT node, the (replanned) agents whose conflicts in the layers below it are gone
+// and tombstones for the single conflicts below it that were removed.
+// Each layer also counts its changes per agent and per agent pair, so a child derives its set from its
+// parent's in O(#excluded agents * depth) instead of reading the inherited conflicts,
+// and the conflicts are visited in the order they were added (bottom layer first).
+class ConflictSet
+{
+	typedef unordered_set<const Conflict*> Tombstones;
+	struct Layer
+	{
+		list<shared_ptr<Conflict> > conflicts; // added in this layer
+		small_vector<int, 2> excluded; // the conflicts of these agents in the layers below are hidden
+		Tombstones removed; // these conflicts in the layers below are hidden
+		unordered_map<uint64_t, int> pair_counts; // #conflicts added - #conflicts removed in this layer per agent pair
+		unordered_map<int, int> agent_counts; // the same per agent
+		shared_ptr<const Layer> base;
+		int depth = 0; // number of layers below
+	};
+	struct Frame
+	{
+		const Layer* layer;
+		small_vector<int, 8> excluded; // the agents hidden by the layers above
+		small_vector<const Tombstones*, 4> removed; // the non-empty tombstones of the layers above
+	};
+
+public:
+	class const_iterator
+	{
+	public:
+		const shared_ptr<Conflict>& operator*() const { return *it; }
+		const shared_ptr<Conflict>* operator->() const { return &*it; }
+		const_iterator& operator++() { ++it; skipHidden(); return *this; }
+		bool operator==(const const_iterator& other) const
+		{
+			if (atEnd() || other.atEnd())
+				return atEnd() == other.atEnd();
+			return frame == other.frame && it == other.it;
+		}
+		bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+	private:
+		small_vector<Frame, 4> frames; // bottom layer first
+		size_t frame = 0;
+		list<shared_ptr<Conflict> >::const_iterator it;
+		bool atEnd() const { return frame == frames.size(); }
+		void skipHidden();
+		friend class ConflictSet;
+	};
+
+	ConflictSet() = default;
+	ConflictSet(const ConflictSet& parent, const list<int>& excluded_agents); // the conflicts of the parent except the excluded agents'
+
+	const_iterator begin() const;
+	const_iterator end() const { return const_iterator(); }
+	bool empty() const { return num == 0; }
+	size_t size() const { return num; }
+	const shared_ptr<Conflict>& back() const; // the last visible conflict, usually found in the top layer
+
+	void push_back(const shared_ptr<Conflict>& conflict);
+	void remove(const shared_ptr<Conflict>& conflict); // the conflict must be in the set
+	void clear() { top.reset(); num = 0; }
+
+private:
+	static const int MAX_DEPTH = 8; // flatten longer chains to keep iteration cheap
+	shared_ptr<Layer> top; // may be shared with descendants, and then it is copied on write
+	size_t num = 0;
+
+	static uint64_t pairKey(int a1, int a2);
+	static bool isHidden(const Conflict& conflict, const small_vector<int, 8>& excluded,
+		const small_vector<const Tombstones*, 4>& removed);
+	static int countAgent(const Layer* layer, int agent); // #visible conflicts of the agent
+	static int countPair(const Layer* layer, int a1, int a2); // #visible conflicts between the two agents
+	static void count(Layer& layer, const Conflict& conflict, int delta);
+	void pushLayer(); // start a private layer on top of the shared one
+	void flatten(); // copy the visible conflicts into a single private layer
+};
+
 
 class HLNode // a virtual base class for high-level node
 {
 public:
-	list<Constraint> constraints; // new constraints
+	ConstraintList constraints; // new constraints
+
+	// fingerprints of the constraints on the path from the root to this node
+	ConstraintFingerprint global_fingerprint; // LEQLENGTH and positive constraints (relevant to all agents)
+	AgentFingerprints agent_fingerprints; // the other constraints, grouped by agent
 
 	int g_val = 0; // sum of costs for CBS, and sum of min f for ECBS
 	int h_val = 0; // admissible h
 	int cost_to_go = 0; // informed but inadmissible h
 	int distance_to_go = 0; // distance to the goal state
+	// online learning
+	int distance_error = 0;
+	int cost_error = 0;
+
 	size_t depth = 0; // depath of this CT node
 	size_t makespan = 0; // makespan over all paths
-	bool h_computed = false;
 
 	uint64_t time_expanded = 0;
 	uint64_t time_generated = 0;
 
-	// For debug
-	string chosen_from = "none"; // chosen from the open/focal/cleanup least
+	bool h_computed = false;
+	bool fully_expanded = false; // online learning
+	node_source chosen_from = SOURCE_NONE; // chosen from the open/focal/cleanup list
+
+#ifdef RECORD_LIST_TOPS
 	int f_of_best_in_cleanup = 0;
 	int f_hat_of_best_in_cleanup = 0;
 	int d_of_best_in_cleanup = 0;
@@ -32,22 +181,18 @@ public:
 	int f_of_best_in_focal = 0;
 	int f_hat_of_best_in_focal = 0;
 	int d_of_best_in_focal = 0;
+#endif
 
 	// conflicts in the current paths
-	list<shared_ptr<Conflict> > conflicts;
+	ConflictSet conflicts; // classified
 	list<shared_ptr<Conflict> > unknownConf;
 
 	// The chosen conflict
 	shared_ptr<Conflict> conflict;
 	// unordered_map<int, pair<int, int> > conflictGraph; //<edge index, <weight, num of CT nodes> >
 
-	// online learning
-	int distance_error = 0;
-	int cost_error = 0;
-	bool fully_expanded = false;
-
 	HLNode* parent;
-	list<HLNode*> children;
+	small_vector<HLNode*, 2> children;
 
 	inline int getFVal() const { return g_val + h_val; }
 	virtual inline int  getFHatVal() const = 0;
@@ -57,6 +202,20 @@ public:
 	void clear();
 	// void printConflictGraph(int num_of_agents) const;
 	void updateDistanceToGo();
+	void updateFingerprints(); // derive the fingerprints from the parent and the new constraints
+	inline ConstraintFingerprint getFingerprint(int agent) const
+	{
+		return global_fingerprint + agent_fingerprints.get(agent);
+	}
+	static bool isGlobalConstraint(const Constraint& constraint)
+	{
+		return get<4>(constraint) == constraint_type::LEQLENGTH ||
+			get<4>(constraint) == constraint_type::POSITIVE_VERTEX ||
+			get<4>(constraint) == constraint_type::POSITIVE_EDGE;
+	}
+#ifdef CHECK_CONSTRAINT_FINGERPRINTS
+	set<Constraint> collectConstraints(int agent) const; // full constraint set by walking up the CT
+#endif
 	void printConstraints(int id) const;
 
     virtual ~HLNode(){}
@@ -65,6 +224,44 @@ public:
 std::ostream& operator<<(std::ostream& os, const HLNode& node);
 
 
+// Allocates the CT nodes of a search in blocks of BLOCK_SIZE nodes. Discarded nodes are recycled,
+// and the blocks are released all at once. All nodes of an arena have the same type.
+class NodeArena
+{
+public:
+	NodeArena() = default;
+	NodeArena(const NodeArena&) = delete;
+	NodeArena& operator=(const NodeArena&) = delete;
+	~NodeArena() { releaseBlocks(); }
+
+	template<typename Node> Node* create()
+	{
+		static_assert(alignof(Node) <= alignof(std::max_align_t), "over-aligned CT node");
+		size_t size = (sizeof(Node) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+		assert(node_size == 0 || node_size == size);
+		node_size = size;
+		return new (allocate()) Node();
+	}
+	void destroy(HLNode* node); // call the destructor and recycle the memory
+	void release(list<HLNode*>& nodes); // destroy the nodes and release all blocks
+
+	// the node shells only: the paths, constraints and conflicts of the nodes are allocated outside the arena
+	size_t getPeakBytes() const { return peak_blocks * BLOCK_SIZE * node_size; }
+	size_t getNodeSize() const { return node_size; }
+
+private:
+	static const size_t BLOCK_SIZE = 256; // nodes per block
+	vector<char*> blocks;
+	size_t used = BLOCK_SIZE; // nodes used in the last block
+	size_t node_size = 0;
+	void* free_nodes = nullptr; // singly linked through the first word of each recycled node
+	size_t peak_blocks = 0;
+
+	void* allocate();
+	void releaseBlocks();
+};
+
+
 class CBSNode: public HLNode
 {
 public:
@@ -180,7 +377,8 @@ struct ConstraintsHasher // Hash a CT node by constraints on one agent
 {
 	int a{};
 	const HLNode* n{};
-	ConstraintsHasher(int a, HLNode* n) : a(a), n(n) {};
+	ConstraintFingerprint fp;
+	ConstraintsHasher(int a, HLNode* n) : a(a), n(n), fp(n->getFingerprint(a)) {};
 
 	struct EqNode
 	{
@@ -188,35 +386,13 @@ struct ConstraintsHasher // Hash a CT node by constraints on one agent
 		{
 			if(c1.a != c2.a)
 				return false;
-				
-			std::set<Constraint> cons1, cons2;
-			auto curr = c1.n;
-			while (curr->parent != nullptr)
-			{
-				if (get<4>(curr->constraints.front()) == constraint_type::LEQLENGTH ||
-					get<4>(curr->constraints.front()) == constraint_type::POSITIVE_VERTEX ||
-					get<4>(curr->constraints.front()) == constraint_type::POSITIVE_EDGE ||
-					get<0>(curr->constraints.front()) == c1.a) {
-					for (auto con : curr->constraints)
-						cons1.insert(con);
-				}
-				curr = curr->parent;
-			}
-			curr = c2.n;
-			while (curr->parent != nullptr)
-			{
-				if (get<4>(curr->constraints.front()) == constraint_type::LEQLENGTH ||
-					get<4>(curr->constraints.front()) == constraint_type::POSITIVE_VERTEX ||
-					get<4>(curr->constraints.front()) == constraint_type::POSITIVE_EDGE ||
-					get<0>(curr->constraints.front()) == c2.a) {
-					for (auto con : curr->constraints)
-						cons2.insert(con);
-				}
-
-				curr = curr->parent;
-			}
-
-			return equal(cons1.begin(), cons1.end(), cons2.begin(), cons2.end());
+#ifdef CHECK_CONSTRAINT_FINGERPRINTS
+			bool rst = c1.n->collectConstraints(c1.a) == c2.n->collectConstraints(c2.a);
+			assert(rst == (c1.fp == c2.fp));
+			return rst;
+#else
+			return c1.fp == c2.fp;
+#endif
 		}
 	};
 
@@ -224,26 +400,7 @@ struct ConstraintsHasher // Hash a CT node by constraints on one agent
 	{
 		std::size_t operator()(const ConstraintsHasher& entry) const
 		{
-			auto curr = entry.n;
-			size_t cons_hash = 0;
-			while (curr->parent != nullptr)
-			{
-				if (get<4>(curr->constraints.front()) == constraint_type::LEQLENGTH ||
-					get<4>(curr->constraints.front()) == constraint_type::POSITIVE_VERTEX ||
-					get<4>(curr->constraints.front()) == constraint_type::POSITIVE_EDGE ||
-					get<0>(curr->constraints.front()) == entry.a)
-				{
-					for (auto con : curr->constraints)
-					{
-						cons_hash += 3 * std::hash<int>()(std::get<0>(con)) +
-							5 * std::hash<int>()(std::get<1>(con)) +
-							7 * std::hash<int>()(std::get<2>(con)) +
-							11 * std::hash<int>()(std::get<3>(con));
-					}
-				}
-				curr = curr->parent;
-			}
-			return cons_hash;
+			return (size_t)entry.fp.lo;
 		}
 	};
 };
@@ -0,0 +1,53 @@
+#pragma once
+#include "common.h"
+#include "Conflict.h"
+#include <fstream>
+#include <cstring>
+
+
+// An append-only log of binary records (a type, a size and the payload), used to checkpoint the high-level
+// search. The records are buffered and flushed at each CHECKPOINT record, and a log cut short (e.g., by a
+// preempted job) is read up to its last CHECKPOINT record. Paths are written as deltas of a base path
+// (the path of the same agent in the parent CT node): the length of the shared prefix, then the rest.
+class CheckpointLog
+{
+public:
+	enum record_type : uint8_t { HEADER, ROOT, NODE, VALUES, PATHS, CLOSE, REOPEN, ENTRY, CHECKPOINT };
+
+	// writing
+	bool create(const string& file_name); // start a new log
+	bool append(const string& file_name, uint64_t length); // cut the log after the first length bytes and append to it
+	bool isOpen() const { return out.is_open(); }
+	void close();
+	template<typename T> void put(const T& value) { record.append((const char*)&value, sizeof(T)); }
+	void putConstraints(const ConstraintList& constraints);
+	void putPath(const Path& path, const Path& base);
+	void write(record_type type); // write the record put so far
+	uint64_t getBytesWritten() const { return bytes_written; }
+
+	// reading
+	bool open(const string& file_name); // find the last CHECKPOINT record; false if there is none
+	bool next(); // read the next record up to the last CHECKPOINT record
+	record_type getType() const { return type; }
+	template<typename T> T get()
+	{
+		T value;
+		assert(pos + sizeof(T) <= record.size());
+		memcpy(&value, record.data() + pos, sizeof(T));
+		pos += sizeof(T);
+		return value;
+	}
+	void getConstraints(ConstraintList& constraints);
+	void getPath(Path& path, const Path& base);
+	uint64_t getLength() const { return length; } // the bytes up to the end of the last CHECKPOINT record
+
+private:
+	std::ofstream out;
+	std::ifstream in;
+	string record; // the payload being written or read
+	size_t pos = 0; // read position in the payload
+	record_type type = HEADER; // of the record read
+	uint64_t length = 0;
+	uint64_t bytes_read = 0;
+	uint64_t bytes_written = 0;
+};
@@ -14,6 +14,7 @@ enum constraint_type { LEQLENGTH, GLENGTH, RANGE, BARRIER, VERTEX, EDGE,
 enum conflict_selection {RANDOM, EARLIEST, CONFLICTS, MCONSTRAINTS, FCONSTRAINTS, WIDTH, SINGLETONS};
 
 typedef std::tuple<int, int, int, int, constraint_type> Constraint;
+typedef small_vector<Constraint, 2> ConstraintList; // the new constraints of a CT node (rarely more than two)
 // <agent, loc, -1, t, VERTEX>
 // <agent, loc, -1, t, POSITIVE_VERTEX>
 // <agent, from, to, t, EDGE> 
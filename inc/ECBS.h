@@ -1,24 +1,66 @@
 #pragma once
 #include "CBS.h"
 #include "ECBSNode.h"
+#include "CheckpointLog.h"
 
 
 class ECBS : public CBS
 {
 public:
-	ECBS(const Instance& instance, bool sipp, int screen) : CBS(instance, sipp, screen) {}
+	ECBS(const Instance& instance, bool sipp, int screen, const CBS* heuristic_source = nullptr,
+		const vector<int>& source_agents = vector<int>()) :
+		CBS(instance, sipp, screen, heuristic_source, source_agents) {}
 
 	// ECBSNode* dummy_start = nullptr;
 	// ECBSNode* goal_node = nullptr;
 
 	////////////////////////////////////////////////////////////////////////////////////////////
 	// Runs the algorithm until the problem is solved or time is exhausted 
-	bool solve(double time_limit, int cost_lowerbound = 0);
+	// cost_upperbound: the cost of a known solution (e.g. of prioritized planning); the search stops without a
+	// solution once the known one is within the suboptimality bound
+	bool solve(double time_limit, int cost_lowerbound = 0, int cost_upperbound = MAX_COST);
     void clear(); // used for rapid random  restart
 
+	void setHLMemoryLimit(int mb) { hl_memory_limit = (size_t)mb * 1024 * 1024; }
+	void setExpansionBatch(int b) { expansion_batch = b; }
+	void setParallelRoot(bool p) { parallel_root = p; }
+	void setAnytime(bool a) { anytime = a; }
+	void setMergeThreshold(int b) { merge_threshold = b; }
+	void setSolutionCallback(const std::function<void()>& f) { solution_callback = f; }
+	void setBestEffort(bool b) { best_effort = b; }
+	void setCheckpoint(const string& file, double interval, bool resume)
+	{
+		checkpoint_file = file;
+		checkpoint_interval = interval;
+		resume_from_checkpoint = resume;
+	}
+
+	void savePaths(const string& fileName) const { CBS::savePaths(fileName, remaining_conflicts); } // the conflicts of a best-effort plan are marked
+
 private:
+	bool parallel_root = false; // plan the root in waves of agents with disjoint corridors
+	int expansion_batch = 1; // >1 means so many CT nodes are expanded together and their children are generated on num_of_threads threads
+	size_t hl_memory_limit = 0; // bytes of CT nodes and paths beyond which the worst unexpanded nodes are retired (0: no limit)
+	size_t hl_memory = 0; // bytes of the CT nodes in allNodes_table and their paths
+	uint64_t retirement_mark = 0; // num_HL_generated + num_regenerated when retireNodes last missed the limit
+	bool retirement_warned = false;
+	bool anytime = false; // keep looking for cheaper solutions after the first one until the time is out
+	std::function<void()> solution_callback; // anytime: called with the paths of each new solution in view
+	bool best_effort = false; // return the plan with the fewest conflicts at the cutoff time if there is no solution
+	list<shared_ptr<Conflict>> remaining_conflicts; // the conflicts of the best-effort plan
+	string checkpoint_file; // the log the search is checkpointed to (empty: none)
+	double checkpoint_interval = 60; // seconds between checkpoints
+	bool resume_from_checkpoint = false; // continue the search in checkpoint_file if it has a checkpoint
+	int merge_threshold = 0; // merge two meta-agents once they conflict more often than this along a branch (0: never)
+
 	vector<int> min_f_vals; // lower bounds of the cost of the shortest path
 	vector< pair<Path, int> > paths_found_initially;  // contain initial paths found
+	ECBSNode* incumbent = nullptr; // anytime: the goal node of the best solution so far
+	int solved_min_f = MAX_COST; // anytime: min f of the goal nodes found, as no cheaper solutions are looked for below them
+	ECBSNode* best_effort_node = nullptr; // best effort: the generated node with the fewest conflicts
+	double last_adaptation = 0; // best effort: when the suboptimality was last checked against the deadline
+	CheckpointLog checkpoint; // see setCheckpoint
+	double last_checkpoint = 0; // runtime of the last checkpoint
 
 	pairing_heap< ECBSNode*, compare<ECBSNode::compare_node_by_f> > cleanup_list; // it is called open list in ECBS
 	pairing_heap< ECBSNode*, compare<ECBSNode::compare_node_by_inadmissible_f> > open_list; // this is used for EES
@@ -28,13 +70,55 @@ private:
 
 	// node operators
 	void pushNode(ECBSNode* node);
-	ECBSNode* selectNode();
+	void insertNode(ECBSNode* node); // insert the node into cleanup/open/focal
+	ECBSNode* selectNode(int inflight_min_f = MAX_COST); // inflight_min_f is the min f of the selected nodes not yet expanded; nullptr if a retired node changed
 	bool reinsertNode(ECBSNode* node);
+	void retireNodes(); // drop the paths and conflicts of the worst unexpanded nodes until the memory is well within the limit
+	bool regenerateNode(ECBSNode* node); // find the paths and conflicts of a retired node again; false if it changed
+	static size_t getPathBytes(const ECBSNode& node); // memory held by the new paths of the node
+	void retireNode(ECBSNode* node); // drop the paths and conflicts of the node
+	bool resumeSearch(); // called when terminate stops the search; returns true if the anytime search goes on
+	void pruneNodes(); // anytime: drop the nodes that cannot lead to a solution cheaper than the incumbent
+	bool refineGoal(ECBSNode* goal); // anytime: replan the paths of a goal node that exceed the current bound
+	bool skipStaleGoal(ECBSNode* node); // anytime: refine a goal node no cheaper than the incumbent instead of returning it
+	void tightenSuboptimality(); // anytime: keep the focal threshold below the cost of the incumbent
+	void adaptSuboptimality(); // best effort: relax the suboptimality if the conflicts are not resolved in time
+	void rebuildFocal(); // after the suboptimality changed
+	void takeBestEffortPlan(); // best effort: put the paths of best_effort_node in view and list its conflicts
+
+	// checkpointing
+	void createCheckpoint(); // start a new log with the instance it is for
+	vector<int> getInstanceSignature() const; // the sizes and the start and goal locations
+	void logNode(const ECBSNode& node, CheckpointLog::record_type type); // NODE when it is generated, PATHS when it adopts a bypass
+	void logValues(const ECBSNode& node); // after its informed heuristics are computed
+	void logEvent(const ECBSNode& node, CheckpointLog::record_type type); // CLOSE when it leaves the lists, REOPEN when it returns
+	void writeCheckpoint(); // log the new look-up table entries and the stats, and flush the log
+	bool loadCheckpoint(); // rebuild the CT and the lists from the last checkpoint; false if there is none
+	ECBSNode* readNode(vector<ECBSNode*>& nodes); // from a NODE or PATHS record
+	template<typename Visitor> void visitCheckpointStats(Visitor visit); // the stats and bounds a checkpoint saves
+	const Path& getParentPath(const ECBSNode& node, int agent) const; // the base of the path deltas in the log
 
 	 // high level search
 	bool generateChild(ECBSNode* child, ECBSNode* curr);
+	void initChild(ECBSNode* child, ECBSNode* curr);
+	bool replanChildren(ECBSNode* child[2], ECBSNode* curr, ChildPaths rst[2]); // generate the paths of both children in parallel
+	bool finishChild(ECBSNode* child, ChildPaths& child_paths); // detect conflicts and compute h once the paths are found
+	bool expandNodes(); // expand a batch of nodes, return true if the search terminates
+	void replanBatch(vector<ECBSNode*>& children, const vector<set<int>>& agents, vector<ChildPaths>& rst);
 	bool generateRoot();
-	bool findPathForSingleAgent(ECBSNode*  node, int ag);
+	void initTables(); // the path views and the look-up tables of a new search
+	void planRootInWaves(ECBSNode* root);
+	void addRootPath(ECBSNode* root, int agent, const pair<Path, int>& path); // one of the paths of the root
+	vector<int> getCorridor(int agent) const; // the cells on a greedy descent of the heuristic of the agent from its start
+	pair<Path, int> searchPath(const ECBSNode* node, int ag, const vector<Path*>& child_paths, int lowerbound); // the low-level search only
+	void addPath(ECBSNode* node, int ag, const pair<Path, int>& new_path, vector<Path*>& child_paths, vector<int>& child_min_f_vals);
+	bool replanAgents(ECBSNode* node, const set<int>& agents, vector<Path*>& child_paths, vector<int>& child_min_f_vals, int threads);
+
+	// meta-agent merging
+	bool mergeAgents(ECBSNode* curr); // true if curr is expanded into one child with the meta-agents of its conflict merged
+	vector<int> getMetaAgent(const ECBSNode* node, int agent) const; // the agents merged with agent in node (sorted)
+	int countConflicts(const ECBSNode* node, const vector<int>& meta_agent1, const vector<int>& meta_agent2) const; // along the branch
+	bool replanMetaAgent(ECBSNode* node, const vector<int>& agents, vector<Path*>& child_paths, vector<int>& child_min_f_vals); // jointly
 	void classifyConflicts(ECBSNode &node);
 	void computeConflictPriority(shared_ptr<Conflict>& con, ECBSNode& node);
 
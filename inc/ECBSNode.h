@@ -73,11 +73,14 @@ public:
 	pairing_heap< ECBSNode*, compare<ECBSNode::compare_node_by_d> >::handle_type focal_handle;
 
 	int sum_of_costs = 0;  // sum of costs of the paths
+	bool restored = false; // loaded from a checkpoint without its conflicts, which are detected when it is selected
 	ECBSNode* parent;
 	list< pair< int, pair<Path, int> > > paths; // new paths <agent id, <path, min f>>	
+	list< pair<int, int> > merges; // the pairs of agents whose meta-agents are merged in this node
 	inline int getFHatVal() const { return sum_of_costs + cost_to_go; }
 	inline int getNumNewPaths() const { return (int) paths.size(); }
 	inline string getName() const { return "ECBS Node"; }
+	inline bool isRetired() const { return parent != nullptr && paths.empty(); } // its paths were dropped to save memory
 	list<int> getReplannedAgents() const
 	{
 		list<int> rst;
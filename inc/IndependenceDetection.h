@@ -0,0 +1,60 @@
+#pragma once
+#include "ECBS.h"
+
+
+// Independence detection: every agent starts in a group of its own, and every group is solved by its own ECBS
+// (the groups of a round in parallel). The groups whose paths conflict are merged and solved again, until the
+// paths of all groups are conflict-free, so the CTs and the look-up tables of the solvers are only as large as
+// the groups.
+class IndependenceDetection
+{
+public:
+	// stats
+	double runtime = 0;
+	bool solution_found = false;
+	int solution_cost = -1;
+	uint64_t num_rounds = 0;
+	uint64_t num_merges = 0; // number of groups merged into other ones
+	uint64_t num_group_solves = 0;
+	uint64_t num_HL_expanded = 0;
+	uint64_t num_HL_generated = 0;
+	uint64_t num_LL_expanded = 0;
+	uint64_t num_LL_generated = 0;
+
+	// set_up_solver configures the ECBS of each group
+	IndependenceDetection(const Instance& instance, bool sipp, int screen, int num_of_threads,
+		const std::function<void(ECBS&)>& set_up_solver);
+	~IndependenceDetection() { heuristic_source.clearSearchEngines(); }
+
+	bool solve(double time_limit);
+
+	void printResults() const;
+	void saveResults(const string& fileName, const string& instanceName) const;
+	void savePaths(const string& fileName) const;
+
+private:
+	struct GroupStats
+	{
+		uint64_t num_HL_expanded = 0;
+		uint64_t num_HL_generated = 0;
+		uint64_t num_LL_expanded = 0;
+		uint64_t num_LL_generated = 0;
+	};
+
+	const Instance& instance;
+	bool sipp;
+	int screen;
+	int num_of_threads;
+	std::function<void(ECBS&)> set_up_solver;
+	ECBS heuristic_source; // computes the heuristic tables of all agents once for the solvers of the groups
+	int num_of_agents;
+
+	vector< vector<int> > groups; // sorted agents
+	vector<Path> paths;
+
+	bool solveGroup(const vector<int>& group, double time_limit, int threads, GroupStats& stats);
+	bool mergeConflictingGroups(vector<int>& merged); // false if the paths of all groups are conflict-free
+	static bool conflicting(const Path& path1, const Path& path2, int num_of_cols);
+	int getMaxGroupSize() const;
+	string getGroupSizes() const; // size x number of groups of that size
+};
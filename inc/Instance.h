@@ -2,6 +2,8 @@
 #include"common.h"
 
 #define D_THETA 45.0
+#define NUM_HEADINGS 16 // 360 / (D_THETA / 2), as the primitives also turn by half a step
+#define HEADING_INDEX(theta) ((((int)round((theta) / (D_THETA / 2))) % NUM_HEADINGS + NUM_HEADINGS) % NUM_HEADINGS)
 #define DEG2RAD(x) (x*(M_PI/180))
 #define WRAPTO360(x) ((fmod(x, 360) < 0) ? fmod(x, 360) + 360 : fmod(x, 360))
 
@@ -18,6 +20,7 @@ public:
 	Instance(){}
 	Instance(const string& map_fname, const string& agent_fname, 
 		int num_of_agents = 0, int num_of_rows = 0, int num_of_cols = 0, int num_of_obstacles = 0, int warehouse_width = 0);
+	Instance(const Instance& instance, const vector<int>& agents); // the map of instance with only the given agents
 
 
 	void printAgents() const;
@@ -28,6 +31,8 @@ public:
 		list<int> getNeighbors(int curr) const;
 		list<int> get_eight_Neighbors(int curr) const;
 		list<list<pair<int, double>>> getPrimitives(int loc, double theta) const;
+		// the moves of the primitives from heading theta, ignoring the map: (row step, column step, new heading, backwards)
+		static list<tuple<int, int, double, bool> > getMotions(double theta);
 
 		inline int linearizeCoordinate(int row, int col) const { return ( this->num_of_cols * row + col); }
 		inline int getRowCoordinate(int id) const { return id / this->num_of_cols; }
@@ -49,6 +54,10 @@ public:
 			return abs(loc1.first - loc2.first) + abs(loc1.second - loc2.second);
 		}
 		list<pair<int, double> > getBezierPathCells(int loc1, double ang1, int loc2, double ang2) const;
+		// the point at ratio in [0, 1] of the cubic Bezier curve from (row1, col1) at heading ang1 to (row2, col2)
+		// at heading ang2 (driving backwards if reverse)
+		static pair<double, double> getBezierPoint(double row1, double col1, double ang1,
+			double row2, double col2, double ang2, bool reverse, double ratio);
 
 	int getDegree(int loc) const
 	{
@@ -0,0 +1,72 @@
+#pragma once
+#include "CBS.h"
+#include <random>
+
+
+enum neighborhood_type { RANDOM_AGENTS, INTERSECTION, DELAYED_AGENT, NEIGHBORHOOD_COUNT };
+
+// Large neighborhood search: improves the sum of costs of a plan until the time is out. Every iteration frees the
+// agents of a neighborhood, replans them against the paths of the other agents as hard constraints, and keeps the
+// new paths if they are cheaper. The neighborhood is
+// - RANDOM_AGENTS: random agents,
+// - INTERSECTION: the agents that visit the cells around a random intersection of the map, or
+// - DELAYED_AGENT: the agent with the largest delay that was not chosen recently, and the agents that visit the
+//   cells of its shortest path,
+// chosen at random with weights that follow the success rate of each type (adaptive LNS).
+// The neighborhood is replanned by prioritized planning in a random order, or by a CBS over its agents.
+class LNS
+{
+public:
+	// stats
+	double runtime = 0;
+	int initial_cost = -1;
+	int solution_cost = -1;
+	int lower_bound = 0; // sum of the lower bounds the low level returns on the costs of the agents on their own
+	uint64_t num_iterations = 0;
+	uint64_t num_improvements = 0;
+	uint64_t num_tried[NEIGHBORHOOD_COUNT] = {}; // per neighborhood type
+	uint64_t num_succeeded[NEIGHBORHOOD_COUNT] = {};
+	vector< pair<double, int> > trace; // <runtime, sum of costs> after each improvement
+
+	// copies the heuristic tables of the low-level search engines of heuristic_source
+	LNS(const CBS& heuristic_source, const Instance& instance, bool sipp, int screen, int neighbor_size, bool cbs_replan);
+	~LNS();
+
+	void run(const vector<Path>& initial_paths, double time_limit);
+	const Path& getPath(int agent) const { return paths[agent]; }
+
+	void printResults() const;
+	void saveTrace(const string& fileName) const; // the sum of costs over time
+	void savePaths(const string& fileName) const;
+
+private:
+	const Instance& instance;
+	int screen;
+	int neighbor_size;
+	bool cbs_replan; // replan a neighborhood by CBS instead of prioritized planning
+	double replan_time_limit = 1; // seconds for a CBS replan
+	int num_of_agents;
+
+	vector<SingleAgentSolver*> search_engines;
+	vector<Path> paths;
+	vector<Path*> path_pointers; // into paths, for the occupancy index
+	OccupancyIndex occupancy;
+	vector<Path> shortest_paths;
+	vector<int> cost_lower_bounds; // on the costs of shortest_paths
+	vector<int> intersections; // the cells with more than two free neighbors
+	list<int> tabu; // the delayed agents chosen recently
+	double weights[NEIGHBORHOOD_COUNT];
+	std::mt19937 rng;
+
+	std::chrono::steady_clock::time_point start;
+	double getRuntime() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); }
+
+	neighborhood_type chooseNeighborhoodType();
+	void generateRandomNeighborhood(set<int>& neighborhood);
+	void generateIntersectionNeighborhood(set<int>& neighborhood);
+	void generateDelayedAgentNeighborhood(set<int>& neighborhood);
+	bool replanNeighborhood(const vector<int>& neighborhood, double time_limit); // true if the sum of costs went down
+	static bool isFree(const Path& path, const ConstraintTable& reservations); // the path does not collide with the reserved ones
+	int getSumOfCosts() const;
+	static string getNeighborhoodName(neighborhood_type type);
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include "ECBS.h"
+
+
+// Lifelong MAPF: every agent works through a sequence of goals, and gets the next one when it reaches the
+// current one. Every replan_interval timesteps, the paths of all agents are planned again from their current
+// locations, and the first replan_interval timesteps of them are executed. The map, the solver with its search
+// engines, and the heuristic tables of the goals (see CBS::setTasks) are kept between the replans.
+class Lifelong
+{
+public:
+	// stats
+	double runtime = 0;
+	int timestep = 0; // simulated so far
+	uint64_t num_replans = 0;
+	uint64_t num_failed_replans = 0; // no plan was found in time, so the agents waited in place
+	uint64_t num_tasks_completed = 0;
+	vector<double> latencies; // wall-clock runtime of each replan
+
+	Lifelong(ECBS& solver, const Instance& instance, int replan_interval, int screen);
+
+	bool loadGoals(const string& fileName); // the goals of each agent after its first one
+	void run(int simulation_time, double replan_time_limit); // until simulation_time or all goals are reached
+
+	void printResults() const;
+	void saveResults(const string& fileName, const string& instanceName) const;
+	void savePaths(const string& fileName) const; // the executed paths
+
+private:
+	ECBS& solver;
+	const Instance& instance;
+	int replan_interval;
+	int screen;
+	int num_of_agents;
+
+	vector<int> locations; // at the current timestep
+	vector<int> goals; // current
+	vector<list<int> > next_goals; // after the current one
+	vector<bool> finished; // reached the last goal
+	vector<bool> waiting; // for its next goal to be released by another agent
+	vector<Path> executed_paths;
+
+	void execute(bool solved, int steps); // move the agents along the plan (or wait in place)
+	void assignNextGoal(int agent);
+	double getLatency(double percentile) const; // nearest-rank percentile of the replan runtimes
+	double getThroughput() const { return timestep == 0 ? 0 : (double)num_tasks_completed / timestep; } // tasks per timestep
+};
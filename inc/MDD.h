@@ -2,6 +2,25 @@
 #include "SingleAgentSolver.h"
 #include "ECBSNode.h"
 
+// A set of cells kept as a sorted list of non-empty 64-bit words,
+// so that MDD levels can be intersected and counted word by word.
+class CellBitset
+{
+public:
+	void set(int cell);
+	void reset(int cell);
+	bool test(int cell) const;
+	int count() const; // number of cells in the set
+	bool isSingleton(int cell) const; // true if the set is exactly {cell}
+	bool intersects(const CellBitset& other) const;
+	void clear() { words.clear(); }
+	bool empty() const { return words.empty(); }
+	size_t getMemoryUsage() const { return sizeof(CellBitset) + words.capacity() * sizeof(pair<int, uint64_t>); }
+
+private:
+	vector<pair<int, uint64_t> > words; // <word index, bits>, sorted by word index
+};
+
 
 class MDDNode
 {
@@ -9,7 +28,7 @@ public:
 	MDDNode(int currloc, double theta, MDDNode* parent)
 	{
 		location = currloc; 
-		theta = theta;
+		this->theta = theta;
 		if(parent == nullptr)
 			level = 0;
 		else
@@ -18,7 +37,7 @@ public:
 			parents.push_back(parent);
 		}
 	}
-	MDDNode(int location, int t): location(location), level(t) {}
+	MDDNode(int location, double theta, int t): location(location), theta(theta), level(t) {}
 	int location;
 	double theta;
 	int level;
@@ -26,8 +45,9 @@ public:
 
 	bool operator == (const MDDNode & node) const
 	{
-		return (this->location == node.location) && (this->level == node.level);
+		return (this->location == node.location) && (this->theta == node.theta) && (this->level == node.level);
 	}
+	int getState() const { return location * NUM_HEADINGS + HEADING_INDEX(theta); } // (location, heading) key
 
 
 	list<MDDNode*> children;
@@ -41,6 +61,8 @@ private:
 
 public:
 	vector<list<MDDNode*>> levels;
+	vector<CellBitset> level_cells; // the cells of each level as a bitset
+	vector<CellBitset> level_states; // the (cell, heading) states of each level as a bitset
 
 	bool buildMDD(const ConstraintTable& ct,
 		int num_of_levels, const SingleAgentSolver* solver); // build mdd of given levels
@@ -48,9 +70,18 @@ public:
 	// bool buildMDD(const std::vector <std::list< std::pair<int, int> > >& constraints, int numOfLevels,
 	// 	int start_location, const int* moves_offset, const std::vector<int>& my_heuristic, int map_size, int num_col);
 
-	MDDNode* find(int location, int level) const;
+	MDDNode* find(int location, double theta, int level) const;
 	void deleteNode(MDDNode* node);
+	bool prune(const ConstraintTable& ct); // return false if no path is left
 	void clear();
+
+	void buildLevelCells(); // rebuild level_cells and level_states from levels
+	size_t getMemoryUsage() const; // approximate number of bytes held by this MDD
+	bool hasCell(int level, int location) const { return level_cells[level].test(location); }
+	int getLevelWidth(int level) const { return level_cells[level].count(); } // number of cells (not states) at the given level
+	bool isSingleton(int level, int location) const { return level_cells[level].isSingleton(location); }
+	bool shareCell(const MDD& other, int level, int other_level) const // do the two levels have a common cell?
+		{ return level_cells[level].intersects(other.level_cells[other_level]); }
 	// bool isConstrained(int curr_id, int next_id, int next_timestep, const std::vector< std::list< std::pair<int, int> > >& cons) const;
 
     void increaseBy(const ConstraintTable&ct, int dLevel, SingleAgentSolver* solver);
@@ -67,9 +98,10 @@ std::ostream& operator<<(std::ostream& os, const MDD& mdd);
 class SyncMDDNode
 {
 public:
-	SyncMDDNode(int currloc, SyncMDDNode* parent)
+	SyncMDDNode(int currloc, double theta, SyncMDDNode* parent)
 	{
 		location = currloc;
+		this->theta = theta;
 		if (parent != nullptr)
 		{
 			//level = parent->level + 1;
@@ -78,11 +110,12 @@ public:
 		//parent = NULL;
 	}
 	int location;
+	double theta;
 	//int level;
 
 	bool operator == (const SyncMDDNode & node) const
 	{
-		return (this->location == node.location);
+		return (this->location == node.location) && (this->theta == node.theta);
 	}
 
 
@@ -98,7 +131,7 @@ class SyncMDD
 public:
 	vector<list<SyncMDDNode*>> levels;
 
-	SyncMDDNode* find(int location, int level) const;
+	SyncMDDNode* find(int location, double theta, int level) const;
 	void deleteNode(SyncMDDNode* node, int level);
 	void clear();
 
@@ -111,6 +144,10 @@ class MDDTable
 public:
 	double accumulated_runtime = 0;  // runtime of building MDDs
 	uint64_t num_released_mdds = 0; // number of released MDDs ( to save memory)
+	uint64_t num_hits = 0; // number of MDDs found in the table
+	uint64_t num_misses = 0; // number of MDDs not found in the table
+	uint64_t num_derived_mdds = 0; // number of missed MDDs derived from the MDDs of the parent CT nodes
+	size_t peak_memory = 0; // max bytes held by the table
 
 	MDDTable(const vector<ConstraintTable>& initial_constraints,
 						const vector<SingleAgentSolver*>& search_engines):
@@ -120,6 +157,7 @@ public:
 	{
 		lookupTable.resize(number_of_agents);
 	}
+	void setMemoryLimit(size_t mb) { memory_limit = mb * 1024 * 1024; }
 	~MDDTable() { clear(); }
 
 	MDD* findMDD(HLNode& node, int agent) const;
@@ -127,14 +165,23 @@ public:
 	// void findSingletons(HLNode& node, int agent, Path& path);
 	void clear();
 private:
-	int max_num_of_mdds = 10000; // per agent
+	size_t memory_limit = (size_t)1024 * 1024 * 1024; // in bytes, over all agents
+	size_t memory_usage = 0; // bytes held by the table
 
-	vector<unordered_map<ConstraintsHasher, MDD*, 
+	struct CachedMDD
+	{
+		MDD* mdd;
+		size_t bytes;
+		list<ConstraintsHasher>::iterator lru_handle; // position in lru_list
+	};
+	vector<unordered_map<ConstraintsHasher, CachedMDD,
 		ConstraintsHasher::Hasher, ConstraintsHasher::EqNode> >lookupTable;
+	list<ConstraintsHasher> lru_list; // keys of all cached MDDs, most recently used first
 
 	const vector<ConstraintTable>& initial_constraints;
 	const vector<SingleAgentSolver*>& search_engines;
-	void releaseMDDMemory(int id);
+	MDD* deriveMDD(HLNode& node, int id, size_t mdd_levels) const;
+	void releaseMDDMemory(); // evict least recently used MDDs until the table fits in memory_limit
 };
 
 unordered_map<int, MDDNode*> collectMDDlevel(MDD* mdd, int i);
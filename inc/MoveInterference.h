@@ -0,0 +1,54 @@
+#pragma once
+#include "common.h"
+
+// Pairwise interference of the moves (primitives) agents make in one timestep, precomputed for every pair of
+// primitives of Instance::getMotions and every relative offset between the two start cells.
+// An agent is a disc of radius AGENT_RADIUS that follows the Bezier curve of its primitive (Instance::getBezierPoint)
+// at the same pace as the other agent, and two moves interfere if the discs overlap strictly inside the timestep:
+// swaps, diagonal crossings, and curves that cut into the other agent's move. Meeting at the start or end cell
+// is a vertex conflict and is not included. The radius is small enough that no move interferes with a wait.
+// A move without known headings (theta < 0, e.g., from SIPP), or one that is no primitive, stands for all
+// primitives with its displacement, and so do the location-only queries.
+class MoveInterference
+{
+public:
+	static const int MAX_STEP = 1; // the primitives move to a neighbouring cell
+	static constexpr double AGENT_RADIUS = 0.2; // in cells; 0.22 is the largest radius that keeps waits apart
+
+	struct Move // a move of the other agent, relative to the start cell of this agent
+	{
+		int offset_row, offset_col; // start cell of the other agent
+		int step_row, step_col; // its displacement
+	};
+
+	// whether the moves from1->to1 and from2->to2 interfere on a map with the given number of columns
+	static bool interfere(const PathEntry& from1, const PathEntry& to1, const PathEntry& from2, const PathEntry& to2,
+		int num_of_cols);
+	static bool interfere(int from1, int to1, int from2, int to2, int num_of_cols); // for any headings
+
+	// all moves that interfere with the move from->to for some headings
+	static const vector<Move>& getInterferingMoves(int from, int to, int num_of_cols);
+
+private:
+	static const int STEPS = 2 * MAX_STEP + 1; // displacements per axis
+	static const int MAX_OFFSET = 2 * MAX_STEP; // farther apart, the agents cannot meet inside the timestep (asserted)
+	static const int OFFSETS = 2 * MAX_OFFSET + 1; // offsets per axis
+	static const int SAMPLES = 64; // the curves are compared at ratios 1/SAMPLES, ..., (SAMPLES - 1)/SAMPLES
+
+	// The first STEPS * STEPS primitive ids are the displacements (all primitives with it, or a wait),
+	// followed by the primitives of every heading.
+	struct Table
+	{
+		vector<int> ids; // [displacement][heading1][heading2] -> primitive id
+		vector<bool> interfere; // [primitive1][offset][primitive2]
+		vector< vector<Move> > moves; // displacement -> the interfering moves
+		int num_of_ids;
+		Table();
+	};
+	static const Table& getTable();
+
+	static int getStepId(int row, int col) { return (row + MAX_STEP) * STEPS + col + MAX_STEP; }
+	static int getOffsetId(int row, int col) { return (row + MAX_OFFSET) * OFFSETS + col + MAX_OFFSET; }
+	static int getPrimitiveId(const PathEntry& from, const PathEntry& to, int num_of_cols);
+	static bool lookUp(int id1, int from1, int id2, int from2, int num_of_cols);
+};
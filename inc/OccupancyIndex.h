@@ -0,0 +1,32 @@
+#pragma once
+#include "common.h"
+
+// The cells visited by the paths of the agents, indexed by cell and timestep, plus the goal arrival
+// times of the agents, so that the agents whose paths may conflict with a path are found without
+// scanning all the other paths.
+// The index follows the paths it is synced with by pointer. A path that is changed in place, or freed
+// while it may still be indexed, must be invalidated.
+// Crossing moves are found through MoveInterference.
+class OccupancyIndex
+{
+public:
+	void reset(int map_size, int num_of_cols); // forget all paths
+	void sync(const vector<Path*>& paths); // reindex the agents whose paths changed
+	void invalidate(int agent) { if (agent < (int)indexed.size()) indexed[agent] = nullptr; }
+
+	// the agents that may collide with the given path (sorted, possibly including the agent of the path itself)
+	void getCandidates(const Path& path, vector<int>& agents) const;
+	void getAgentsAt(int loc, int timestep, vector<int>& agents) const; // including the agents waiting at their goals
+	void getAgentsVisiting(int loc, int from_timestep, vector<int>& agents) const; // at any timestep >= from_timestep
+
+private:
+	int num_of_cols = 0;
+	vector<const Path*> indexed; // the path each agent is indexed with
+	vector< vector<int> > locations; // copies of the indexed paths, to remove them after they are changed
+	vector< vector< pair<int, int> > > visits; // location -> sorted <timestep, agent>
+	vector< vector< pair<int, int> > > goals; // location -> <arrival timestep, agent> of the agents that end there
+
+	void add(int agent, const Path& path);
+	void remove(int agent);
+	void getVisitsAt(int loc, int timestep, vector<int>& agents) const; // not including the agents waiting at their goals
+};
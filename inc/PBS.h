@@ -0,0 +1,69 @@
+#pragma once
+#include "PBSNode.h"
+#include "SingleAgentSolver.h"
+#include "OccupancyIndex.h"
+#include <chrono>
+
+
+// Priority-based search: instead of constraints, the high level branches on the priority of the two agents of a
+// conflict. Every node adds one priority pair, and the agent with the lower priority, and all agents below it whose
+// paths then collide with a higher-priority path, are replanned in topological order against the paths of the agents
+// with higher priority, which are reserved as hard constraints. The search is depth-first, expanding the cheaper
+// child first, and ends at the first node without conflicts. It is incomplete and suboptimal, but its nodes are cheap
+// and it scales to much denser instances than CBS.
+class PBS
+{
+public:
+	// stats
+	double runtime = 0;
+	bool solution_found = false;
+	int solution_cost = -1;
+	int root_cost = 0; // sum of the costs of the shortest paths of the agents on their own
+	uint64_t num_HL_expanded = 0;
+	uint64_t num_HL_generated = 0;
+	uint64_t num_LL_expanded = 0;
+	uint64_t num_LL_generated = 0;
+	uint64_t num_root_conflicts = 0;
+	uint64_t num_dead_ends = 0; // children with an agent that has no path
+
+	PBS(const Instance& instance, bool sipp, int screen);
+	~PBS();
+
+	bool solve(double time_limit);
+	const Path& getPath(int agent) const { return *paths[agent]; }
+
+	void printResults() const;
+	void saveResults(const string& fileName, const string& instanceName) const; // its first columns are those of CBS
+	void savePaths(const string& fileName) const;
+
+private:
+	const Instance& instance;
+	int screen;
+	int num_of_agents;
+
+	vector<SingleAgentSolver*> search_engines;
+	vector<Path*> paths; // of the current node
+	OccupancyIndex occupancy;
+	vector< vector<int> > lower_agents; // the priority pairs of the current node: agent -> agents directly below it
+	list<PBSNode*> allNodes_table;
+	vector<PBSNode*> open_list; // a stack
+
+	std::chrono::steady_clock::time_point start;
+	double time_limit = 0;
+	double getRuntime() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); }
+
+	bool generateRoot();
+	bool generateChild(PBSNode* child);
+	void updatePaths(PBSNode* node); // set paths and lower_agents to those of the node
+	bool replan(PBSNode* node, int agent, const vector<int>& higher);
+	void findConflicts(PBSNode* node, const set<int>& replanned);
+
+	vector<int> getHigherAgents(int agent) const;
+	bool isHigher(int a1, int a2) const; // a1 has a higher priority than a2
+	void topologicalSort(int agent, vector<bool>& visited, list<int>& order) const; // agent and the agents below it
+	bool collide(int a1, int a2) const; // under the priorities of the current node
+	bool collide(const Path& lower, const Path& higher) const;
+
+	void pushNode(PBSNode* node);
+	void releaseNodes();
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include "common.h"
+
+
+// A node of the priority tree of PBS. It adds one priority pair to those of its ancestors, and stores the paths of
+// the agents it replanned to respect them; the paths of the other agents are those of its ancestors.
+class PBSNode
+{
+public:
+	PBSNode* parent = nullptr;
+	pair<int, int> priority = make_pair(-1, -1); // <higher, lower> agent (none at the root)
+	list< pair<int, Path> > paths; // new paths
+	list< pair<int, int> > conflicts; // the pairs of agents whose paths collide
+	int cost = 0; // sum of costs
+	int depth = 0;
+	uint64_t time_generated = 0;
+
+	PBSNode() = default;
+	PBSNode(PBSNode* parent, int higher, int lower) :
+		parent(parent), priority(higher, lower), depth(parent->depth + 1) {}
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include "CBS.h"
+
+
+// Prioritized planning: the agents are planned one after another in a priority order, each by its low-level
+// search against the paths of the agents before it, which are reserved as hard constraints. The search is
+// incomplete, but fast, so it solves the easy instances directly and bounds the cost of the search on the
+// others (see ECBS::solve). The first two orders are heuristic (the agents with the longest and with the
+// shortest shortest paths first), and the others are random; the orders are tried on num_of_threads threads.
+class PrioritizedPlanning
+{
+public:
+	// stats
+	double runtime = 0;
+	bool solution_found = false;
+	int solution_cost = -1;
+	int lower_bound = 0; // sum of the lower bounds the low level returns on the costs of the agents on their own
+	int best_order = -1; // the order of the solution
+	uint64_t num_orders = 0; // tried
+	uint64_t num_failed_orders = 0; // an agent had no path (the others were solved, or given up as too expensive)
+	uint64_t num_LL_expanded = 0;
+	uint64_t num_LL_generated = 0;
+
+	// copies the heuristic tables of the low-level search engines of heuristic_source
+	PrioritizedPlanning(const CBS& heuristic_source, const Instance& instance, bool sipp, int screen, int num_of_threads);
+
+	bool solve(double time_limit, int num_of_orders);
+	const Path& getPath(int agent) const { return paths[agent]; }
+
+	void printResults() const;
+	void saveResults(const string& fileName, const string& instanceName) const;
+	void savePaths(const string& fileName) const;
+
+private:
+	const CBS& heuristic_source;
+	const Instance& instance;
+	bool sipp;
+	int screen;
+	int num_of_threads;
+	int num_of_agents;
+
+	vector<Path> paths; // of the best order
+	vector<int> shortest_path_costs; // lower bounds on them
+
+	std::chrono::steady_clock::time_point start;
+	double time_limit = 0;
+	double getRuntime() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); }
+
+	vector<int> getOrder(int order) const; // the priority order with the given index
+	// returns the sum of costs, -1 if an agent has no path, or -2 if the plan gets more expensive than best_cost
+	int planInOrder(const vector<int>& order, vector<SingleAgentSolver*>& search_engines, vector<Path>& order_paths,
+		const std::atomic<int>& best_cost, uint64_t& expanded, uint64_t& generated) const;
+	static string getOrderName(int order);
+};
@@ -79,6 +79,7 @@ public:
 
     SIPP(const Instance& instance, int agent):
             SingleAgentSolver(instance, agent) {}
+    SIPP(const SingleAgentSolver& other): SingleAgentSolver(other) {} // reuse the heuristic table of other
 
 private:
     // define typedefs and handles for heap
@@ -19,6 +19,15 @@ public:
     bool is_goal = false;
 	bool in_progress = false; // flag to check if the node is a part of a longer primitive path
 	list<pair<int, double> > path_remaining; // a vector of cells consisting of the remaining long primitive path
+	// break the remaining ties by state rather than by rand(), so that searches running in different threads
+	// (see CBS::replanChildren) neither share the random state nor depend on the thread interleaving
+	static bool breakTies(const LLNode* n1, const LLNode* n2)
+	{
+		if (n1->location == n2->location)
+			return n1->theta >= n2->theta;
+		return n1->location >= n2->location;
+	}
+
 	// the following is used to compare nodes in the OPEN list
 	struct compare_node
 	{
@@ -29,7 +38,7 @@ public:
             {
                 if (n1->h_val == n2->h_val)
                 {
-                    return rand() % 2 == 0;   // break ties randomly
+                    return breakTies(n1, n2);
                 }
                 return n1->h_val >= n2->h_val;  // break ties towards smaller h_vals (closer to goal location)
             }
@@ -48,7 +57,7 @@ public:
                 {
                     if (n1->h_val == n2->h_val)
                     {
-                        return rand() % 2 == 0;   // break ties randomly
+                        return breakTies(n1, n2);
                     }
                     return n1->h_val >= n2->h_val;  // break ties towards smaller h_vals (closer to goal location)
                 }
@@ -96,6 +105,7 @@ public:
 	double runtime_build_CAT = 0; // runtime of building conflict avoidance table
 
 	int start_location;
+	double start_theta = 0; // the heading at the start (lifelong: the heading the agent arrived with)
 	int goal_location;
 	vector<int> my_heuristic;  // this is the precomputed heuristic for this agent
 	int compute_heuristic(int from, int to) const  // compute admissible heuristic between two locations
@@ -112,6 +122,7 @@ public:
 	virtual string getName() const = 0;
 
 	list<pair<int,double>> getNextLocations(int curr,double theta) const; // including itself and its neighbors
+	void setTask(int start, double theta, int goal, const vector<int>* heuristic = nullptr); // heuristic: the table of the goal, or nullptr to compute it
 	// list<int> getNextLocations(int curr) const; // including itself and its neighbors
 	// list<int> getNeighbors(int curr) const { return instance.getNeighbors(curr); }
 
@@ -69,6 +69,7 @@ public:
 
 	SpaceTimeAStar(const Instance& instance, int agent):
 		SingleAgentSolver(instance, agent) {}
+	SpaceTimeAStar(const SingleAgentSolver& other): SingleAgentSolver(other) {} // reuse the heuristic table of other
 
 private:
 	// define typedefs and handles for heap
@@ -8,6 +8,7 @@
 #include <iostream>     // std::cout, std::fixed
 #include <iomanip>      // std::setprecision
 #include <boost/heap/pairing_heap.hpp>
+#include <boost/container/small_vector.hpp>
 #include <boost/unordered_set.hpp>
 #include <boost/unordered_map.hpp>
 
@@ -15,6 +16,7 @@ using boost::heap::pairing_heap;
 using boost::heap::compare;
 using boost::unordered_map;
 using boost::unordered_set;
+using boost::container::small_vector;
 using std::vector;
 using std::list;
 using std::set;
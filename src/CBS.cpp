@@ -1,6 +1,7 @@
 ﻿#include <algorithm>    // std::shuffle
 #include <random>      // std::default_random_engine
 #include <chrono>       // std::chrono::system_clock
+#include <thread>
 #include "CBS.h"
 #include "SIPP.h"
 #include "SpaceTimeAStar.h"
@@ -69,7 +70,8 @@ void CBS::copyConflicts(const list<shared_ptr<Conflict >>& conflicts,
 void CBS::findConflicts(HLNode& curr, int a1, int a2)
 {
 	int min_path_length = (int) (paths[a1]->size() < paths[a2]->size() ? paths[a1]->size() : paths[a2]->size());
-	for (int timestep = 0; timestep < min_path_length; timestep++)
+	int horizon = min(min_path_length, window); // the conflicts from the window on are left to the next replan
+	for (int timestep = 0; timestep < horizon; timestep++)
 	{
 		int loc1 = paths[a1]->at(timestep).location;
 		int loc2 = paths[a2]->at(timestep).location;
@@ -92,7 +94,7 @@ void CBS::findConflicts(HLNode& curr, int a1, int a2)
 			assert(!conflict->constraint2.empty());
 			curr.unknownConf.push_back(conflict);
 		}
-		else if (timestep < min_path_length - 1
+		else if (timestep < horizon - 1
 			&& loc1 == paths[a2]->at(timestep + 1).location
 			&& loc2 == paths[a1]->at(timestep + 1).location)
 		{
@@ -102,10 +104,11 @@ void CBS::findConflicts(HLNode& curr, int a1, int a2)
 			assert(!conflict->constraint2.empty());
 			curr.unknownConf.push_back(conflict); // edge conflict
 		}
-		else if (timestep < min_path_length - 1){
+		else if (timestep < horizon - 1){
 			int loc1_next = paths[a1]->at(timestep+1).location;
 			int loc2_next = paths[a2]->at(timestep+1).location;
-			if(loc1+loc1_next == loc2 + loc2_next){
+			if (MoveInterference::interfere(paths[a1]->at(timestep), paths[a1]->at(timestep + 1),
+				paths[a2]->at(timestep), paths[a2]->at(timestep + 1), search_engines[0]->instance.num_of_cols)) {
 				cout << "\n*****Found diagonal conflict!";
 				shared_ptr<Conflict> conflict(new Conflict());
 				conflict->diagonalEdgeConflict(a1, a2, loc1, loc1_next, loc2, loc2_next, timestep + 1);
@@ -120,7 +123,7 @@ void CBS::findConflicts(HLNode& curr, int a1, int a2)
 		int a1_ = paths[a1]->size() < paths[a2]->size() ? a1 : a2;
 		int a2_ = paths[a1]->size() < paths[a2]->size() ? a2 : a1;
 		int loc1 = paths[a1_]->back().location;
-		for (int timestep = min_path_length; timestep < (int)paths[a2_]->size(); timestep++)
+		for (int timestep = min_path_length; timestep < min((int)paths[a2_]->size(), window); timestep++)
 		{
 			int loc2 = paths[a2_]->at(timestep).location;
 			if (loc1 == loc2)
@@ -141,46 +144,60 @@ void CBS::findConflicts(HLNode& curr, int a1, int a2)
 
 void CBS::findConflicts(HLNode& curr)
 {
-	clock_t t = clock();
-	if (curr.parent != nullptr)
+	if (curr.parent == nullptr)
 	{
-		// Copy from parent
-		auto new_agents = curr.getReplannedAgents();
-		copyConflicts(curr.parent->conflicts, curr.conflicts, new_agents);
-		copyConflicts(curr.parent->unknownConf, curr.unknownConf, new_agents);
+		findAllConflicts(curr);
+		return;
+	}
+	clock_t t = clock();
+	occupancy.sync(paths);
+	vector<int> candidates; // the agents whose paths may collide with a1's path
+
+	// Share the classified conflicts with the parent, and copy the unclassified ones
+	auto new_agents = curr.getReplannedAgents();
+	curr.conflicts = ConflictSet(curr.parent->conflicts, new_agents);
+	copyConflicts(curr.parent->unknownConf, curr.unknownConf, new_agents);
 
-		// detect new conflicts
-		for (auto it = new_agents.begin(); it != new_agents.end(); ++it)
+	// detect new conflicts
+	for (auto it = new_agents.begin(); it != new_agents.end(); ++it)
+	{
+		int a1 = *it;
+		occupancy.getCandidates(*paths[a1], candidates);
+		for (auto a2 : candidates)
 		{
-			int a1 = *it;
-			for (int a2 = 0; a2 < num_of_agents; a2++)
+			if (a1 == a2)
+				continue;
+			bool skip = false;
+			for (auto it2 = new_agents.begin(); it2 != it; ++it2)
 			{
-				if (a1 == a2)
-					continue;
-				bool skip = false;
-				for (auto it2 = new_agents.begin(); it2 != it; ++it2)
+				if (*it2 == a2)
 				{
-					if (*it2 == a2)
-					{
-						skip = true;
-						break;
-					}
+					skip = true;
+					break;
 				}
-				findConflicts(curr, a1, a2);
 			}
+			if (!skip) // the pair has been checked already
+				findConflicts(curr, a1, a2);
 		}
 	}
-	else
+	// curr.distance_to_go = (int)(curr.unknownConf.size() + curr.conflicts.size());
+	runtime_detect_conflicts += (double)(clock() - t) / CLOCKS_PER_SEC;
+}
+
+void CBS::findAllConflicts(HLNode& curr)
+{
+	clock_t t = clock();
+	occupancy.sync(paths);
+	vector<int> candidates; // the agents whose paths may collide with a1's path
+	for (int a1 = 0; a1 < num_of_agents; a1++)
 	{
-		for (int a1 = 0; a1 < num_of_agents; a1++)
+		occupancy.getCandidates(*paths[a1], candidates);
+		for (auto a2 : candidates)
 		{
-			for (int a2 = a1 + 1; a2 < num_of_agents; a2++)
-			{
+			if (a2 > a1)
 				findConflicts(curr, a1, a2);
-			}
 		}
 	}
-	// curr.distance_to_go = (int)(curr.unknownConf.size() + curr.conflicts.size());
 	runtime_detect_conflicts += (double)(clock() - t) / CLOCKS_PER_SEC;
 }
 
@@ -284,15 +301,15 @@ void CBS::computeConflictPriority(shared_ptr<Conflict>& con, CBSNode& node)
 
 	if (type == constraint_type::EDGE) // Edge conflict
 	{
-		cardinal1 = mdd1->levels[timestep].size() == 1 && mdd1->levels[timestep - 1].size() == 1;
-		cardinal2 = mdd2->levels[timestep].size() == 1 && mdd2->levels[timestep - 1].size() == 1;
+		cardinal1 = mdd1->getLevelWidth(timestep) == 1 && mdd1->getLevelWidth(timestep - 1) == 1;
+		cardinal2 = mdd2->getLevelWidth(timestep) == 1 && mdd2->getLevelWidth(timestep - 1) == 1;
 	}
 	else // vertex conflict or target conflict
 	{
 		if (!cardinal1)
-			cardinal1 = mdd1->levels[timestep].size() == 1;
+			cardinal1 = mdd1->getLevelWidth(timestep) == 1;
 		if (!cardinal2)
-			cardinal2 = mdd2->levels[timestep].size() == 1;
+			cardinal2 = mdd2->getLevelWidth(timestep) == 1;
 	}
 
 	/*int width_1 = 1, width_2 = 1;
@@ -409,7 +426,7 @@ void CBS::classifyConflicts(CBSNode &node)
 	removeLowPriorityConflicts(node.conflicts);
 }
 
-void CBS::removeLowPriorityConflicts(list<shared_ptr<Conflict>>& conflicts) const
+void CBS::removeLowPriorityConflicts(ConflictSet& conflicts) const
 {
 	if (conflicts.empty())
 		return;
@@ -441,42 +458,135 @@ void CBS::removeLowPriorityConflicts(list<shared_ptr<Conflict>>& conflicts) cons
 	}
 }
 
-bool CBS::findPathForSingleAgent(CBSNode*  node, int ag, int lowerbound)
+Path CBS::searchPath(const CBSNode* node, int ag, int lowerbound, const vector<Path*>& child_paths)
 {
 	clock_t t = clock();
 	// build reservation table
 	// CAT cat(node->makespan + 1);  // initialized to false
 	// updateReservationTable(cat, ag, *node);
 	// find a path
-	Path new_path = search_engines[ag]->findOptimalPath(*node, initial_constraints[ag], paths, ag, lowerbound);
-	num_LL_expanded += search_engines[ag]->num_expanded;
-	num_LL_generated += search_engines[ag]->num_generated;
-	runtime_build_CT += search_engines[ag]->runtime_build_CT;
-	runtime_build_CAT += search_engines[ag]->runtime_build_CAT;
-	runtime_path_finding += (double)(clock() - t) / CLOCKS_PER_SEC;
-	if (!new_path.empty())
-	{
-		assert(!isSamePath(*paths[ag], new_path));
-		node->paths.emplace_back(ag, new_path);
-		node->g_val = node->g_val - (int)paths[ag]->size() + (int)new_path.size();
-		paths[ag] = &node->paths.back().second;
-		node->makespan = max(node->makespan, new_path.size() - 1);
-		return true;
+	Path new_path = search_engines[ag]->findOptimalPath(*node, initial_constraints[ag], child_paths, ag, lowerbound);
+	{
+		std::lock_guard<std::mutex> lock(stats_mutex);
+		num_LL_expanded += search_engines[ag]->num_expanded;
+		num_LL_generated += search_engines[ag]->num_generated;
+		runtime_build_CT += search_engines[ag]->runtime_build_CT;
+		runtime_build_CAT += search_engines[ag]->runtime_build_CAT;
+		runtime_path_finding += (double)(clock() - t) / CLOCKS_PER_SEC;
+	}
+	return new_path;
+}
+
+void CBS::addPath(CBSNode* node, int ag, const Path& new_path, vector<Path*>& child_paths)
+{
+	assert(!isSamePath(*child_paths[ag], new_path));
+	node->paths.emplace_back(ag, new_path);
+	node->g_val = node->g_val - (int)child_paths[ag]->size() + (int)new_path.size();
+	child_paths[ag] = &node->paths.back().second;
+	node->makespan = max(node->makespan, new_path.size() - 1);
+}
+
+// With more than one thread, the agents are replanned concurrently against a frozen snapshot of child_paths,
+// i.e., they do not see each other's new paths in the CAT, and the new paths are added in increasing agent order.
+// This holds for any number of threads > 1, so the result does not depend on it.
+bool CBS::replanAgents(CBSNode* node, const set<int>& agents, vector<Path*>& child_paths, int threads)
+{
+	vector<int> order(agents.begin(), agents.end());
+	vector<Path> new_paths(order.size());
+	if (num_of_threads > 1 && order.size() > 1)
+	{
+		parallelFor(order.size(), threads, [&](size_t i)
+		{
+			new_paths[i] = searchPath(node, order[i], (int)child_paths[order[i]]->size() - 1, child_paths);
+		});
 	}
-	else
+	for (size_t i = 0; i < order.size(); i++)
 	{
-		return false;
+		if (num_of_threads < 2 || order.size() < 2) // replan one after another, each agent sees the new paths of the previous ones
+			new_paths[i] = searchPath(node, order[i], (int)child_paths[order[i]]->size() - 1, child_paths);
+		if (new_paths[i].empty())
+			return false;
+		addPath(node, order[i], new_paths[i], child_paths);
 	}
+	return true;
 }
 
-bool CBS::generateChild(CBSNode*  node, CBSNode* parent)
+void CBS::parallelFor(size_t n, int threads, const std::function<void(size_t)>& task)
+{
+	std::atomic<size_t> next(0);
+	auto work = [&]()
+	{
+		for (size_t i = next++; i < n; i = next++)
+			task(i);
+	};
+	vector<std::thread> workers;
+	for (int i = 1; i < threads && i < (int)n; i++)
+		workers.emplace_back(work);
+	work();
+	for (auto& worker : workers)
+		worker.join();
+}
+
+void CBS::initChild(CBSNode*  node, CBSNode* parent)
 {
-	clock_t t1 = clock();
 	node->parent = parent;
 	node->HLNode::parent = parent;
 	node->g_val = parent->g_val;
 	node->makespan = parent->makespan;
 	node->depth = parent->depth + 1;
+	node->updateFingerprints();
+}
+
+bool CBS::getChildrenAgents(const HLNode* child1, const HLNode* child2, set<int> agents[2])
+{
+	agents[0] = getInvalidAgents(child1->constraints);
+	agents[1] = getInvalidAgents(child2->constraints);
+	for (auto agent : agents[0])
+	{
+		if (agents[1].find(agent) != agents[1].end())
+			return false; // the two searches would share the search engine of this agent
+	}
+	return true;
+}
+
+bool CBS::replanChildren(CBSNode* child[2], CBSNode* parent, ChildPaths rst[2])
+{
+	set<int> agents[2];
+	if (num_of_threads < 2 || !getChildrenAgents(child[0], child[1], agents))
+		return false;
+	clock_t t1 = clock();
+	for (int i = 0; i < 2; i++)
+	{
+		initChild(child[i], parent);
+		rst[i].paths = paths;
+	}
+	auto replan = [&](int i)
+	{
+		rst[i].solved = replanAgents(child[i], agents[i], rst[i].paths, max(1, num_of_threads / 2));
+	};
+	std::thread worker(replan, 1);
+	replan(0);
+	worker.join();
+	runtime_generate_child += (double)(clock() - t1) / CLOCKS_PER_SEC;
+	return true;
+}
+
+bool CBS::finishChild(CBSNode* node, ChildPaths& child_paths)
+{
+	if (!child_paths.solved)
+		return false;
+	clock_t t1 = clock();
+	paths = child_paths.paths;
+	findConflicts(*node);
+	heuristic_helper.computeQuickHeuristics(*node);
+	runtime_generate_child += (double)(clock() - t1) / CLOCKS_PER_SEC;
+	return true;
+}
+
+bool CBS::generateChild(CBSNode*  node, CBSNode* parent)
+{
+	clock_t t1 = clock();
+	initChild(node, parent);
 	/*int agent, x, y, t;
 	constraint_type type;
 	assert(node->constraints.size() > 0);
@@ -566,14 +676,10 @@ bool CBS::generateChild(CBSNode*  node, CBSNode* parent)
 
 	auto agents = getInvalidAgents(node->constraints);
 	assert(!agents.empty());
-	for (auto agent : agents)
+	if (!replanAgents(node, agents, paths, num_of_threads))
 	{
-		int lowerbound = (int)paths[agent]->size() - 1;
-		if (!findPathForSingleAgent(node, agent, lowerbound))
-		{
-			runtime_generate_child += (double)(clock() - t1) / CLOCKS_PER_SEC;
-			return false;
-		}
+		runtime_generate_child += (double)(clock() - t1) / CLOCKS_PER_SEC;
+		return false;
 	}
 
 	findConflicts(*node);
@@ -647,7 +753,7 @@ CBSNode* CBS::selectNode()
         case high_level_solver_type::ASTAR:
             cost_lowerbound = max(cost_lowerbound, cleanup_list.top()->getFVal());
             curr = cleanup_list.top();
-            curr->chosen_from = "cleanup";
+            curr->chosen_from = SOURCE_CLEANUP;
             /*curr->f_of_best_in_cleanup = cleanup_list.top()->getFVal();
             curr->f_hat_of_best_in_cleanup = cleanup_list.top()->getFHatVal();
             curr->d_of_best_in_cleanup = cleanup_list.top()->distance_to_go;*/
@@ -677,7 +783,7 @@ CBSNode* CBS::selectNode()
 
             // choose best d in the focal list
             curr = focal_list.top();
-            curr->chosen_from = "focal";
+            curr->chosen_from = SOURCE_FOCAL;
             /*curr->f_of_best_in_cleanup = cleanup_list.top()->getFVal();
             curr->f_hat_of_best_in_cleanup = cleanup_list.top()->getFHatVal();
             curr->d_of_best_in_cleanup = cleanup_list.top()->distance_to_go;
@@ -716,7 +822,8 @@ CBSNode* CBS::selectNode()
             { // return best d
                 curr = focal_list.top();
                 /* for debug */
-                curr->chosen_from = "focal";
+                curr->chosen_from = SOURCE_FOCAL;
+#ifdef RECORD_LIST_TOPS
                 curr->f_of_best_in_cleanup = cleanup_list.top()->getFVal();
                 curr->f_hat_of_best_in_cleanup = cleanup_list.top()->getFHatVal();
                 curr->d_of_best_in_cleanup = cleanup_list.top()->distance_to_go;
@@ -726,6 +833,7 @@ CBSNode* CBS::selectNode()
                 curr->f_of_best_in_focal = focal_list.top()->getFVal();
                 curr->f_hat_of_best_in_focal = focal_list.top()->getFHatVal();
                 curr->d_of_best_in_focal = focal_list.top()->distance_to_go;
+#endif
                 /* end for debug */
                 focal_list.pop();
                 cleanup_list.erase(curr->cleanup_handle);
@@ -735,7 +843,8 @@ CBSNode* CBS::selectNode()
             { // return best f_hat
                 curr = open_list.top();
                 /* for debug */
-                curr->chosen_from = "open";
+                curr->chosen_from = SOURCE_OPEN;
+#ifdef RECORD_LIST_TOPS
                 curr->f_of_best_in_cleanup = cleanup_list.top()->getFVal();
                 curr->f_hat_of_best_in_cleanup = cleanup_list.top()->getFHatVal();
                 curr->d_of_best_in_cleanup = cleanup_list.top()->distance_to_go;
@@ -745,6 +854,7 @@ CBSNode* CBS::selectNode()
                 curr->f_of_best_in_focal = focal_list.top()->getFVal();
                 curr->f_hat_of_best_in_focal = focal_list.top()->getFHatVal();
                 curr->d_of_best_in_focal = focal_list.top()->distance_to_go;
+#endif
                 /* end for debug */
                 open_list.pop();
                 cleanup_list.erase(curr->cleanup_handle);
@@ -754,7 +864,8 @@ CBSNode* CBS::selectNode()
             { // return best f
                 curr = cleanup_list.top();
                 /* for debug */
-                curr->chosen_from = "cleanup";
+                curr->chosen_from = SOURCE_CLEANUP;
+#ifdef RECORD_LIST_TOPS
                 curr->f_of_best_in_cleanup = cleanup_list.top()->getFVal();
                 curr->f_hat_of_best_in_cleanup = cleanup_list.top()->getFHatVal();
                 curr->d_of_best_in_cleanup = cleanup_list.top()->distance_to_go;
@@ -764,6 +875,7 @@ CBSNode* CBS::selectNode()
                 curr->f_of_best_in_focal = focal_list.top()->getFVal();
                 curr->f_hat_of_best_in_focal = focal_list.top()->getFHatVal();
                 curr->d_of_best_in_focal = focal_list.top()->distance_to_go;
+#endif
                 /* end for debug */
                 cleanup_list.pop();
                 open_list.erase(curr->open_handle);
@@ -797,7 +909,7 @@ CBSNode* CBS::selectNode()
             {
                 // choose best f in the cleanup list (to improve the lower bound)
                 curr = cleanup_list.top();
-                curr->chosen_from = "cleanup";
+                curr->chosen_from = SOURCE_CLEANUP;
                 /*curr->f_of_best_in_cleanup = cleanup_list.top()->getFVal();
                 curr->f_hat_of_best_in_cleanup = cleanup_list.top()->getFHatVal();
                 curr->d_of_best_in_cleanup = cleanup_list.top()->distance_to_go;*/
@@ -807,7 +919,7 @@ CBSNode* CBS::selectNode()
             {
                 // choose best d in the focal list
                 curr = focal_list.top();
-                /*curr->chosen_from = "focal";
+                /*curr->chosen_from = SOURCE_FOCAL;
                 curr->f_of_best_in_cleanup = cleanup_list.top()->getFVal();
                 curr->f_hat_of_best_in_cleanup = cleanup_list.top()->getFHatVal();
                 curr->d_of_best_in_cleanup = cleanup_list.top()->distance_to_go;
@@ -829,7 +941,7 @@ CBSNode* CBS::selectNode()
 }
 
 
-set<int> CBS::getInvalidAgents(const list<Constraint>& constraints)  // return agents that violate the constraints
+set<int> CBS::getInvalidAgents(const ConstraintList& constraints)  // return agents that violate the constraints
 {
 	set<int> agents;
 	int agent, x, y, t;
@@ -837,40 +949,37 @@ set<int> CBS::getInvalidAgents(const list<Constraint>& constraints)  // return a
 	assert(!constraints.empty());
 	tie(agent, x, y, t, type) = constraints.front();
 
+	vector<int> candidates;
 	if (type == constraint_type::LEQLENGTH)
 	{
 		assert(constraints.size() == 1);
-		for (int ag = 0; ag < num_of_agents; ag++)
+		occupancy.sync(paths);
+		occupancy.getAgentsVisiting(x, t, candidates);
+		for (auto ag : candidates)
 		{
-			if (ag == agent)
-				continue;
-			for (int i = t; i < (int)paths[ag]->size(); i++)
-			{
-				if (paths[ag]->at(i).location == x)
-				{
-					agents.insert(ag);
-					break;
-				}
-			}
+			if (ag != agent)
+				agents.insert(ag);
 		}
 	}
 	else if (type == constraint_type::POSITIVE_VERTEX)
 	{
 		assert(constraints.size() == 1);
-		for (int ag = 0; ag < num_of_agents; ag++)
+		occupancy.sync(paths);
+		occupancy.getAgentsAt(x, t, candidates);
+		for (auto ag : candidates)
 		{
-			if (ag == agent)
-				continue;
-			if (getAgentLocation(ag, t) == x)
-			{
+			if (ag != agent)
 				agents.insert(ag);
-			}
 		}
 	}
 	else if (type == constraint_type::POSITIVE_EDGE)
 	{
 		assert(constraints.size() == 1);
-		for (int ag = 0; ag < num_of_agents; ag++)
+		occupancy.sync(paths);
+		occupancy.getAgentsAt(x, t - 1, candidates);
+		occupancy.getAgentsAt(y, t - 1, candidates);
+		occupancy.getAgentsAt(y, t, candidates);
+		for (auto ag : candidates)
 		{
 			if (ag == agent)
 				continue;
@@ -980,7 +1089,12 @@ void CBS::saveResults(const string &fileName, const string &instanceName) const
 			"runtime of rectangle conflicts,runtime of corridor conflicts,runtime of mutex conflicts," <<
 			"runtime of building MDDs,runtime of building constraint tables,runtime of building CATs," <<
 			"runtime of path finding,runtime of generating child nodes," <<
-			"preprocessing runtime,solver name,instance name" << endl;
+			"preprocessing runtime,solver name,instance name," <<
+			// the columns added since are appended, so that the columns above keep their positions
+			"#root conflicts,#root waves,suboptimality,#remaining conflicts,#merges," <<
+			"#MDD hits,#MDD misses,#derived MDDs,#released MDDs,peak MDD memory (MB)," <<
+			"peak CT node shell memory (MB),bytes per CT node shell,#retired CT nodes,#regenerated CT nodes," <<
+			"runtime of generating root,portfolio config,portfolio win" << endl;
 		addHeads.close();
 	}
 	ofstream stats(fileName, std::ios::app);
@@ -1012,7 +1126,16 @@ void CBS::saveResults(const string &fileName, const string &instanceName) const
 		mdd_helper.accumulated_runtime << "," << runtime_build_CT << "," << runtime_build_CAT << "," <<
 		runtime_path_finding << "," << runtime_generate_child << "," <<
 
-		runtime_preprocessing << "," << getSolverName() << "," << instanceName << endl;
+		runtime_preprocessing << "," << getSolverName() << "," << instanceName << "," <<
+
+		num_root_conflicts << "," << num_root_waves << "," <<
+		suboptimality << "," << num_remaining_conflicts << "," << num_merges << "," <<
+		mdd_helper.num_hits << "," << mdd_helper.num_misses << "," << mdd_helper.num_derived_mdds << "," << mdd_helper.num_released_mdds << "," <<
+		mdd_helper.peak_memory / (1024.0 * 1024) << "," <<
+		node_arena.getPeakBytes() / (1024.0 * 1024) << "," <<
+		node_arena.getNodeSize() << "," <<
+		num_retired << "," << num_regenerated << "," <<
+		runtime_generate_root << "," << portfolio_config << "," << portfolio_win << endl;
 	stats.close();
 }
 
@@ -1081,11 +1204,11 @@ void CBS::saveCT(const string &fileName) const // write the CT to a file
 			{
 				output << "\n #" << node->time_expanded << " from " << node->chosen_from;
 				output << "\", color=";
-				if (node->chosen_from == "focal")
+				if (node->chosen_from == SOURCE_FOCAL)
 					output << "blue]" << endl;
-				else if (node->chosen_from == "cleanup")
+				else if (node->chosen_from == SOURCE_CLEANUP)
 					output << "green]" << endl;
-				else if (node->chosen_from == "open")
+				else if (node->chosen_from == SOURCE_OPEN)
 					output << "orange]" << endl;
 			}
 			else
@@ -1114,19 +1237,23 @@ void CBS::saveCT(const string &fileName) const // write the CT to a file
 		output.open(fileName + "-tree.csv", std::ios::out);
 		// header
 		output << "time generated,g value,h value,h^ value,d value,depth,time expanded,chosen from,h computed," 
+#ifdef RECORD_LIST_TOPS
 			<< "f of best in cleanup,f^ of best in cleanup,d of best in cleanup," 
 			<< "f of best in open,f^ of best in open,d of best in open," 
 			<< "f of best in focal,f^ of best in focal,d of best in focal,"
+#endif
 			<< "praent,goal node" << endl;
 		for (auto& node : allNodes_table)
 		{
 			output << node->time_generated << ","
 				<< node->g_val << "," << node->h_val << "," << node->getFHatVal() - node->g_val << "," <<  node->distance_to_go << ","
 				<< node->depth << ","
-				<< node->time_expanded << "," << node->chosen_from << "," << node->h_computed << ","
-				<< node->f_of_best_in_cleanup << "," << node->f_hat_of_best_in_cleanup << "," << node->d_of_best_in_cleanup << ","
+				<< node->time_expanded << "," << node->chosen_from << "," << node->h_computed << ",";
+#ifdef RECORD_LIST_TOPS
+			output << node->f_of_best_in_cleanup << "," << node->f_hat_of_best_in_cleanup << "," << node->d_of_best_in_cleanup << ","
 				<< node->f_of_best_in_open << "," << node->f_hat_of_best_in_open << "," << node->d_of_best_in_open << ","
 				<< node->f_of_best_in_focal << "," << node->f_hat_of_best_in_focal << "," << node->d_of_best_in_focal << ",";
+#endif
 			if (node->parent == nullptr)
 				output << "0,";
 			else
@@ -1141,19 +1268,27 @@ void CBS::saveCT(const string &fileName) const // write the CT to a file
 
 }
 
-void CBS::savePaths(const string &fileName) const
+void CBS::savePaths(const string &fileName, const list<shared_ptr<Conflict>>& conflicts) const
 {
+    vector<bool> in_conflict(num_of_agents, false);
+    for (const auto& conflict : conflicts)
+    {
+        in_conflict[conflict->a1] = true;
+        in_conflict[conflict->a2] = true;
+    }
     std::ofstream output;
     output.open(fileName, std::ios::out);
     for (int i = 0; i < num_of_agents; i++)
     {
-        output << "Agent " << i << ": ";
+        output << "Agent " << i << (in_conflict[i] ? " (in conflict)" : "") << ": ";
         for (const auto & t : *paths[i])
             output << "(" << search_engines[0]->instance.getRowCoordinate(t.location)
                    << "," << search_engines[0]->instance.getColCoordinate(t.location) 
 				   << "," << t.theta << ")->";
         output << endl;
     }
+    for (const auto& conflict : conflicts)
+        output << "Conflict: " << *conflict << endl;
     output.close();
 }
 
@@ -1224,7 +1359,7 @@ bool CBS::solve(double _time_limit, int _cost_lowerbound, int _cost_upperbound)
 		cout << name << ": ";
 	}
 	// set timer
-	start = clock();
+	start = std::chrono::steady_clock::now();
 
 	cout << "\nBefore CBS generate root";
 	generateRoot();
@@ -1254,10 +1389,10 @@ bool CBS::solve(double _time_limit, int _cost_lowerbound, int _cost_upperbound)
 		if (!curr->h_computed) // heuristics has not been computed yet
 		{
 			cout << "\nheuristics not yet computed";
-			runtime = (double)(clock() - start) / CLOCKS_PER_SEC;
+			runtime = getRuntime();
 			bool succ = heuristic_helper.computeInformedHeuristics(*curr, time_limit - runtime);
 			cout << "\nComputed informed heuristics+++++++++++++++";
-			runtime = (double)(clock() - start) / CLOCKS_PER_SEC;
+			runtime = getRuntime();
             heuristic_helper.updateOnlineHeuristicErrors(*curr);
 			cout << "\nUpdated online heuristics++++++++++++++";
             heuristic_helper.updateInadmissibleHeuristics(*curr); // compute inadmissible heuristics
@@ -1289,7 +1424,7 @@ bool CBS::solve(double _time_limit, int _cost_lowerbound, int _cost_upperbound)
 			if(terminate(curr))
 				return solution_found;
 			foundBypass = false;
-			CBSNode* child[2] = { new CBSNode() , new CBSNode() };
+			CBSNode* child[2] = { node_arena.create<CBSNode>() , node_arena.create<CBSNode>() };
 
 			curr->conflict = chooseConflict(*curr);
 
@@ -1301,15 +1436,17 @@ bool CBS::solve(double _time_limit, int _cost_lowerbound, int _cost_upperbound)
 
 			bool solved[2] = { false, false };
 			vector<vector<PathEntry>*> copy(paths);
+			ChildPaths child_paths[2];
+			bool replanned = replanChildren(child, curr, child_paths);
 
 			for (int i = 0; i < 2; i++)
 			{
 				if (i > 0)
 					paths = copy;
-				solved[i] = generateChild(child[i], curr);
+				solved[i] = replanned ? finishChild(child[i], child_paths[i]) : generateChild(child[i], curr);
 				if (!solved[i])
 				{
-					delete (child[i]);
+					discardNode(child[i]);
 					continue;
 				}
 				else if (bypass && child[i]->g_val == curr->g_val && child[i]->distance_to_go < curr->distance_to_go) // Bypass1
@@ -1331,6 +1468,7 @@ bool CBS::solve(double _time_limit, int _cost_lowerbound, int _cost_upperbound)
 							{
 								p->second = path.second;
 								paths[p->first] = &p->second;
+								occupancy.invalidate(p->first); // changed in place
 								break;
 							}
 							++p;
@@ -1352,7 +1490,7 @@ bool CBS::solve(double _time_limit, int _cost_lowerbound, int _cost_upperbound)
 			{
 				for (auto & i : child)
 				{
-					delete i;
+					discardNode(i);
 					i = nullptr;
 				}
 				if (PC) // prioritize conflicts
@@ -1392,11 +1530,11 @@ bool CBS::solve(double _time_limit, int _cost_lowerbound, int _cost_upperbound)
 				default:
 					break;
 				}
-				if (curr->chosen_from == "cleanup")
+				if (curr->chosen_from == SOURCE_CLEANUP)
 					num_cleanup++;
-				else if (curr->chosen_from == "open")
+				else if (curr->chosen_from == SOURCE_OPEN)
 					num_open++;
-				else if (curr->chosen_from == "focal")
+				else if (curr->chosen_from == SOURCE_FOCAL)
 					num_focal++;
 				if (curr->conflict->priority == conflict_priority::CARDINAL)
 					num_cardinal_conflicts++;
@@ -1407,17 +1545,18 @@ bool CBS::solve(double _time_limit, int _cost_lowerbound, int _cost_upperbound)
 	return solution_found;
 }
 
-bool CBS::terminate(HLNode* curr)
+bool CBS::terminate(HLNode* curr, bool anytime)
 {
-	if (cost_lowerbound >= cost_upperbound)
+	if (cost_lowerbound >= cost_upperbound ||
+		(!anytime && suboptimality * cost_lowerbound >= cost_upperbound)) // the solution of cost_upperbound is good enough
 	{
 		solution_cost = cost_lowerbound;
 		solution_found = false;
-        if (screen > 0) // 1 or 2
+        if (screen > 0 && !anytime) // 1 or 2; the anytime search prints its best solution instead
             printResults();
 		return true;
 	}
-	runtime = (double)(clock() - start) / CLOCKS_PER_SEC;
+	runtime = getRuntime();
 	if (curr->conflicts.empty() && curr->unknownConf.empty()) //no conflicts
 	{// found a solution
 		solution_found = true;
@@ -1433,11 +1572,11 @@ bool CBS::terminate(HLNode* curr)
 			printResults();
 		return true;
 	}
-	if (runtime > time_limit || num_HL_expanded > node_limit)
-	{   // time/node out
+	if (runtime > time_limit || num_HL_expanded > node_limit || (cancel_flag != nullptr && *cancel_flag))
+	{   // time/node out, or cancelled
 		solution_cost = -1;
 		solution_found = false;
-        if (screen > 0) // 1 or 2
+        if (screen > 0 && !anytime) // 1 or 2
             printResults();
 		return true;
 	}
@@ -1452,7 +1591,7 @@ void CBS::addConstraints(const HLNode* curr, HLNode* child1, HLNode* child2) con
 		int first = (bool)(rand() % 2);
 		if (first) // disjoint splitting on the first agent
 		{
-			child1->constraints = curr->conflict->constraint1;
+			child1->constraints.assign(curr->conflict->constraint1.begin(), curr->conflict->constraint1.end());
 			int a, x, y, t;
 			constraint_type type;
 			tie(a, x, y, t, type) = curr->conflict->constraint1.back();
@@ -1468,7 +1607,7 @@ void CBS::addConstraints(const HLNode* curr, HLNode* child1, HLNode* child2) con
 		}
 		else // disjoint splitting on the second agent
 		{
-			child2->constraints = curr->conflict->constraint2;
+			child2->constraints.assign(curr->conflict->constraint2.begin(), curr->conflict->constraint2.end());
 			int a, x, y, t;
 			constraint_type type;
 			tie(a, x, y, t, type) = curr->conflict->constraint2.back();
@@ -1485,8 +1624,8 @@ void CBS::addConstraints(const HLNode* curr, HLNode* child1, HLNode* child2) con
 	}
 	else
 	{
-		child1->constraints = curr->conflict->constraint1;
-		child2->constraints = curr->conflict->constraint2;
+		child1->constraints.assign(curr->conflict->constraint1.begin(), curr->conflict->constraint1.end());
+		child2->constraints.assign(curr->conflict->constraint2.begin(), curr->conflict->constraint2.end());
 	}
 }
 
@@ -1507,7 +1646,7 @@ CBS::CBS(vector<SingleAgentSolver*>& search_engines,
 	mutex_helper.search_engines = search_engines;
 }
 
-CBS::CBS(const Instance& instance, bool sipp, int screen) :
+CBS::CBS(const Instance& instance, bool sipp, int screen, const CBS* heuristic_source, const vector<int>& source_agents) :
 	screen(screen), suboptimality(1),
 	num_of_agents(instance.getDefaultNumberOfAgents()),
 	mdd_helper(initial_constraints, search_engines),
@@ -1523,7 +1662,12 @@ CBS::CBS(const Instance& instance, bool sipp, int screen) :
 	search_engines.resize(num_of_agents);
 	for (int i = 0; i < num_of_agents; i++)
 	{
-		if (sipp)
+		int source = source_agents.empty() ? i : source_agents[i];
+		if (heuristic_source != nullptr && sipp)
+			search_engines[i] = new SIPP(*heuristic_source->search_engines[source]);
+		else if (heuristic_source != nullptr)
+			search_engines[i] = new SpaceTimeAStar(*heuristic_source->search_engines[source]);
+		else if (sipp)
 			search_engines[i] = new SIPP(instance, i);
 		else
 			search_engines[i] = new SpaceTimeAStar(instance, i);
@@ -1551,18 +1695,17 @@ vector<int> CBS::shuffleAgents() const
 
 	if (randomRoot)
 	{
-		std::random_device rd;
-		std::mt19937 g(rd());
-		std::shuffle(std::begin(agents), std::end(agents), g);
+		std::shuffle(std::begin(agents), std::end(agents), rng);
 	}
 	return agents;
 }
 
 bool CBS::generateRoot()
 {
-	auto root = new CBSNode();
+	auto root = node_arena.create<CBSNode>();
 	root->g_val = 0;
 	paths.resize(num_of_agents, nullptr);
+	occupancy.reset(search_engines[0]->instance.map_size, search_engines[0]->instance.num_of_cols);
 
 	mdd_helper.init(num_of_agents);
 	heuristic_helper.init();
@@ -1595,7 +1738,7 @@ bool CBS::generateRoot()
 			{
 				if (screen >= 2)
 					cout << "No path exists for agent " << i << endl;
-				delete root;
+				discardNode(root);
 				return false;
 			}
 			paths[i] = &paths_found_initially[i];
@@ -1618,12 +1761,14 @@ bool CBS::generateRoot()
 	root->h_val = 0;
 	root->depth = 0;
 	findConflicts(*root);
+	num_root_conflicts = root->unknownConf.size();
 	cout << "\nFinished CBS find conflicts";
 	heuristic_helper.computeQuickHeuristics(*root);
 	cout << "\nCompute quick heuristics is done";
 	pushNode(root);
 	cout << "\nroot node pushed";
 	dummy_start = root;
+	runtime_generate_root = getRuntime();
 	cout << "\ndummy start created";
 	cout << "\n" << screen;
 	if (screen >= 2) // print start and goals
@@ -1635,14 +1780,19 @@ bool CBS::generateRoot()
 	return true;
 }
 
+void CBS::discardNode(HLNode* node)
+{
+	for (auto agent : node->getReplannedAgents()) // its paths may be indexed
+		occupancy.invalidate(agent);
+	node_arena.destroy(node);
+}
+
 inline void CBS::releaseNodes()
 {
 	open_list.clear();
 	cleanup_list.clear();
 	focal_list.clear();
-	for (auto& node : allNodes_table)
-		delete node;
-	allNodes_table.clear();
+	node_arena.release(allNodes_table);
 }
 
 
@@ -1663,6 +1813,55 @@ CBS::~CBS()
 	mdd_helper.clear();
 }
 
+void CBS::setTasks(const vector<PathEntry>& starts, const vector<int>& goals)
+{
+	for (int i = 0; i < num_of_agents; i++)
+	{
+		auto engine = search_engines[i];
+		if (engine->goal_location == goals[i])
+		{
+			engine->setTask(starts[i].location, starts[i].theta, goals[i]);
+			continue;
+		}
+		int old_goal = engine->goal_location;
+		auto old_table = engine->my_heuristic;
+		auto it = heuristic_cache.find(goals[i]);
+		if (it != heuristic_cache.end())
+		{
+			engine->setTask(starts[i].location, starts[i].theta, goals[i], &it->second.table);
+			heuristic_lru.splice(heuristic_lru.begin(), heuristic_lru, it->second.lru_handle);
+			num_heuristic_cache_hits++;
+		}
+		else
+		{
+			engine->setTask(starts[i].location, starts[i].theta, goals[i]);
+			num_heuristic_cache_misses++;
+		}
+		cacheHeuristic(old_goal, std::move(old_table)); // the goal may come back
+	}
+}
+
+void CBS::cacheHeuristic(int goal, vector<int>&& table)
+{
+	auto it = heuristic_cache.find(goal);
+	if (it != heuristic_cache.end())
+		heuristic_lru.splice(heuristic_lru.begin(), heuristic_lru, it->second.lru_handle);
+	else
+	{
+		heuristic_lru.push_front(goal);
+		heuristic_cache_bytes += table.size() * sizeof(int);
+		heuristic_cache[goal] = CachedHeuristic{std::move(table), heuristic_lru.begin()};
+	}
+	while (heuristic_cache_bytes > heuristic_cache_limit && !heuristic_lru.empty())
+	{
+		auto& evicted = heuristic_cache[heuristic_lru.back()].table;
+		heuristic_cache_bytes -= evicted.size() * sizeof(int);
+		heuristic_cache.erase(heuristic_lru.back());
+		heuristic_lru.pop_back();
+		num_heuristic_cache_evictions++;
+	}
+}
+
 void CBS::clearSearchEngines()
 {
 	int cnt = 0;
@@ -1689,13 +1888,19 @@ bool CBS::validateSolution() const
 
 	// check whether the paths are feasible
 	size_t soc = 0;
+	occupancy.sync(paths);
+	vector<int> candidates;
 	for (int a1 = 0; a1 < num_of_agents; a1++)
 	{
 		soc += paths[a1]->size() - 1;
-		for (int a2 = a1 + 1; a2 < num_of_agents; a2++)
+		occupancy.getCandidates(*paths[a1], candidates);
+		for (auto a2 : candidates)
 		{
+			if (a2 <= a1)
+				continue;
 			size_t min_path_length = paths[a1]->size() < paths[a2]->size() ? paths[a1]->size() : paths[a2]->size();
-			for (size_t timestep = 0; timestep < min_path_length; timestep++)
+			size_t horizon = min(min_path_length, (size_t)window); // collisions from the window on are allowed
+			for (size_t timestep = 0; timestep < horizon; timestep++)
 			{
 				int loc1 = paths[a1]->at(timestep).location;
 				int loc2 = paths[a2]->at(timestep).location;
@@ -1704,7 +1909,7 @@ bool CBS::validateSolution() const
 					cout << "Agents " << a1 << " and " << a2 << " collides at " << loc1 << " at timestep " << timestep << endl;
 					return false;
 				}
-				else if (timestep < min_path_length - 1
+				else if (timestep < horizon - 1
 					&& loc1 == paths[a2]->at(timestep + 1).location
 					&& loc2 == paths[a1]->at(timestep + 1).location)
 				{
@@ -1712,13 +1917,21 @@ bool CBS::validateSolution() const
 						loc1 << "-->" << loc2 << ") at timestep " << timestep << endl;
 					return false;
 				}
+				else if (timestep < horizon - 1 &&
+					MoveInterference::interfere(paths[a1]->at(timestep), paths[a1]->at(timestep + 1),
+						paths[a2]->at(timestep), paths[a2]->at(timestep + 1), search_engines[0]->instance.num_of_cols))
+				{
+					cout << "Agents " << a1 << " and " << a2 << " cross at (" << loc1 << "-->" <<
+						paths[a1]->at(timestep + 1).location << ") at timestep " << timestep << endl;
+					return false;
+				}
 			}
 			if (paths[a1]->size() != paths[a2]->size())
 			{
 				int a1_ = paths[a1]->size() < paths[a2]->size() ? a1 : a2;
 				int a2_ = paths[a1]->size() < paths[a2]->size() ? a2 : a1;
 				int loc1 = paths[a1_]->back().location;
-				for (size_t timestep = min_path_length; timestep < paths[a2_]->size(); timestep++)
+				for (size_t timestep = min_path_length; timestep < min(paths[a2_]->size(), (size_t)window); timestep++)
 				{
 					int loc2 = paths[a2_]->at(timestep).location;
 					if (loc1 == loc2)
@@ -518,7 +518,7 @@ bool CBSHeuristic::buildDependenceGraph(CBSNode& node, vector<int>& CG, int& num
         {
             CG[idx] = dependent(a1, a2, node)? 1 : 0;
             CG[a2 * num_of_agents + a1] = CG[idx];
-            lookupTable[a1][a2][HTableEntry(a1, a2, &node)] = make_tuple(CG[idx], 1, 0);
+            memorize(a1, a2, node, make_tuple(CG[idx], 1, 0));
             if ((clock() - start_time) / CLOCKS_PER_SEC > time_limit) // run out of time
             {
                 runtime_build_dependency_graph += (double)(clock() - start_time) / CLOCKS_PER_SEC;
@@ -554,7 +554,7 @@ bool CBSHeuristic::buildWeightedDependencyGraph(CBSNode& node, vector<int>& CG)
 		{
 			auto rst = solve2Agents(a1, a2, node, false);
 			assert(rst.first >= 0);
-			lookupTable[a1][a2][HTableEntry(a1, a2, &node)] = make_tuple(rst.first, rst.second, 1);
+			memorize(a1, a2, node, make_tuple(rst.first, rst.second, 1));
 			CG[idx] = rst.first;
 			CG[a2 * num_of_agents + a1] = rst.first;
 		}
@@ -569,13 +569,13 @@ bool CBSHeuristic::buildWeightedDependencyGraph(CBSNode& node, vector<int>& CG)
 			{
 				auto rst = solve2Agents(a1, a2, node, cardinal);
 				assert(rst.first >= 1);
-				lookupTable[a1][a2][HTableEntry(a1, a2, &node)] = make_tuple(rst.first, rst.second, 1);
+				memorize(a1, a2, node, make_tuple(rst.first, rst.second, 1));
 				CG[idx] = rst.first;
 				CG[a2 * num_of_agents + a1] = rst.first;
 			}
 			else
 			{
-				lookupTable[a1][a2][HTableEntry(a1, a2, &node)]  = make_tuple(0, 1, 0); // h=0, #CT nodes = 1
+				memorize(a1, a2, node, make_tuple(0, 1, 0)); // h=0, #CT nodes = 1
 				CG[idx] = 0;
 				CG[a2 * num_of_agents + a1] = 0;
 			}
@@ -602,6 +602,7 @@ bool CBSHeuristic::buildWeightedDependencyGraph(CBSNode& node, vector<int>& CG)
 
 bool CBSHeuristic::buildWeightedDependencyGraph(ECBSNode& node, const vector<int>& min_f_vals, vector<int>& CG, int& delta_g)
 {
+    // the min f of an agent can exceed its shortest path, as the heuristic on the lattice can overestimate
     delta_g = 0;
     vector<bool> counted(num_of_agents, false); // record the agents whose delta_g has been counted
 	cout << "\nInside buildWeightedDepencyGraph";
@@ -621,14 +622,12 @@ bool CBSHeuristic::buildWeightedDependencyGraph(ECBSNode& node, const vector<int
             CG[a2 * num_of_agents + a1] = CG[idx];
             if (!counted[a1])
             {
-                assert(get<1>(got->second) >= min_f_vals[a1]);
-                delta_g += get<1>(got->second) - min_f_vals[a1];
+                delta_g += max(get<1>(got->second) - min_f_vals[a1], 0);
                 counted[a1] = true;
             }
             if (!counted[a2])
             {
-                assert(get<2>(got->second) >= min_f_vals[a2]);
-                delta_g += get<2>(got->second) - min_f_vals[a2];
+                delta_g += max(get<2>(got->second) - min_f_vals[a2], 0);
                 counted[a2] = true;
             }
 		}
@@ -637,7 +636,7 @@ bool CBSHeuristic::buildWeightedDependencyGraph(ECBSNode& node, const vector<int
 			cout << "\nNot found in lookup";
 			auto rst = solve2Agents(a1, a2, node);
 			cout << "\n solve2Agents returned";
-            lookupTable[a1][a2][HTableEntry(a1, a2, &node)] = rst;
+            memorize(a1, a2, node, rst);
             if ((clock() - start_time) / CLOCKS_PER_SEC > time_limit) // run out of time
             {
                 runtime_build_dependency_graph += (double)(clock() - start_time) / CLOCKS_PER_SEC;
@@ -648,14 +647,12 @@ bool CBSHeuristic::buildWeightedDependencyGraph(ECBSNode& node, const vector<int
             CG[a2 * num_of_agents + a1] = CG[idx];
             if (!counted[a1])
             {
-                assert(get<1>(rst) >= min_f_vals[a1]);
-                delta_g += get<1>(rst) - min_f_vals[a1];
+                delta_g += max(get<1>(rst) - min_f_vals[a1], 0);
                 counted[a1] = true;
             }
             if (!counted[a2])
             {
-                assert(get<2>(rst) >= min_f_vals[a2]);
-                delta_g += get<2>(rst) - min_f_vals[a2];
+                delta_g += max(get<2>(rst) - min_f_vals[a2], 0);
                 counted[a2] = true;
             }
 		}
@@ -680,14 +677,12 @@ bool CBSHeuristic::buildWeightedDependencyGraph(ECBSNode& node, const vector<int
             CG[a2 * num_of_agents + a1] = CG[idx];
             if (!counted[a1])
             {
-                assert(get<1>(got->second) >= min_f_vals[a1]);
-                delta_g += get<1>(got->second) - min_f_vals[a1];
+                delta_g += max(get<1>(got->second) - min_f_vals[a1], 0);
                 counted[a1] = true;
             }
             if (!counted[a2])
             {
-                assert(get<2>(got->second) >= min_f_vals[a2]);
-                delta_g += get<2>(got->second) - min_f_vals[a2];
+                delta_g += max(get<2>(got->second) - min_f_vals[a2], 0);
                 counted[a2] = true;
             }
         }
@@ -696,7 +691,7 @@ bool CBSHeuristic::buildWeightedDependencyGraph(ECBSNode& node, const vector<int
             cout << "\nNot in loopup";
 			auto rst = solve2Agents(a1, a2, node);
 			cout << "\nFinishing solve2Agents";
-            lookupTable[a1][a2][HTableEntry(a1, a2, &node)] = rst;
+            memorize(a1, a2, node, rst);
             if ((clock() - start_time) / CLOCKS_PER_SEC > time_limit) // run out of time
             {
                 runtime_build_dependency_graph += (double)(clock() - start_time) / CLOCKS_PER_SEC;
@@ -706,14 +701,12 @@ bool CBSHeuristic::buildWeightedDependencyGraph(ECBSNode& node, const vector<int
             CG[a2 * num_of_agents + a1] = CG[idx];
             if (!counted[a1])
             {
-                assert(get<1>(rst) >= min_f_vals[a1]);
-                delta_g += get<1>(rst) - min_f_vals[a1];
+                delta_g += max(get<1>(rst) - min_f_vals[a1], 0);
                 counted[a1] = true;
             }
             if (!counted[a2])
             {
-                assert(get<2>(rst) >= min_f_vals[a2]);
-                delta_g += get<2>(rst) - min_f_vals[a2];
+                delta_g += max(get<2>(rst) - min_f_vals[a2], 0);
                 counted[a2] = true;
             }
         }
@@ -742,6 +735,7 @@ pair<int, int> CBSHeuristic::solve2Agents(int a1, int a2, const CBSNode& node, b
 	cbs.setRectangleReasoning(rectangle_reasoning);
 	cbs.setCorridorReasoning(corridor_reasoning);
 	cbs.setTargetReasoning(target_reasoning);
+	cbs.setWindow(window);
 	cbs.setMutexReasoning(mutex_reasoning);
 	cbs.setConflictSelectionRule(conflict_seletion_rule);
 	cbs.setNodeSelectionRule(node_selection_rule);
@@ -793,6 +787,7 @@ tuple<int, int, int> CBSHeuristic::solve2Agents(int a1, int a2, const ECBSNode&
 	cbs.setRectangleReasoning(rectangle_reasoning);
 	cbs.setCorridorReasoning(corridor_reasoning);
 	cbs.setTargetReasoning(target_reasoning);
+	cbs.setWindow(window);
 	cbs.setMutexReasoning(mutex_reasoning);
 	cbs.setConflictSelectionRule(conflict_seletion_rule);
 	cbs.setNodeSelectionRule(node_selection_rule);
@@ -1470,6 +1465,21 @@ int CBSHeuristic::DPForConstrainedWMVC(std::vector<bool>& x, int i, int sum, con
 	}
 }*/
 
+void CBSHeuristic::memorize(int a1, int a2, HLNode& node, const tuple<int, int, int>& value)
+{
+	auto& entry = *lookupTable[a1][a2].emplace(HTableEntry(a1, a2, &node), value).first;
+	entry.second = value;
+	if (log_new_entries)
+		new_entries.push_back(&entry);
+}
+
+vector<const HTable::value_type*> CBSHeuristic::takeNewEntries()
+{
+	vector<const HTable::value_type*> rst;
+	rst.swap(new_entries);
+	return rst;
+}
+
 bool CBSHeuristic::dependent(int a1, int a2, HLNode& node) // return true if the two agents are dependent
 {
 	const MDD* mdd1 = mdd_helper.getMDD(node, a1, paths[a1]->size()); // get mdds
@@ -1477,6 +1487,28 @@ bool CBSHeuristic::dependent(int a1, int a2, HLNode& node) // return true if the
 	if (mdd1->levels.size() > mdd2->levels.size()) // swap
 		std::swap(mdd1, mdd2);
 	num_merge_MDDs++;
+	if (mdd2->levels.size() > 1)
+	{
+		// Check the level bitsets first. The agents are independent if they never share a cell
+		// and never swap cells, and dependent if both are forced to the same cell at some level.
+		bool may_collide = false;
+		int last1 = (int)mdd1->levels.size() - 1; // mdd1 waits at its goal after its last level
+		for (int t = 0; t < (int)mdd2->levels.size(); t++)
+		{
+			int t1 = min(t, last1);
+			if (mdd1->shareCell(*mdd2, t1, t))
+			{
+				if (mdd1->getLevelWidth(t1) == 1 && mdd2->getLevelWidth(t) == 1)
+					return true;
+				may_collide = true;
+			}
+			else if (!may_collide && t + 1 < (int)mdd2->levels.size() &&
+				mdd1->shareCell(*mdd2, t1, t + 1) && mdd1->shareCell(*mdd2, min(t + 1, last1), t))
+				may_collide = true;
+		}
+		if (!may_collide)
+			return false;
+	}
 	return !SyncMDDs(*mdd1, *mdd2);
 }
 
@@ -1493,9 +1525,15 @@ bool CBSHeuristic::SyncMDDs(const MDD &mdd, const MDD& other) // assume mdd.leve
 		copy.levels.resize(other.levels.size());
 		for (; i < copy.levels.size(); i++)
 		{
+			// wait at the goal location; the last level may hold several headings, so all of them lead to the waiting node
 			SyncMDDNode* parent = copy.levels[i - 1].front();
-			auto node = new SyncMDDNode(parent->location, parent);
+			auto node = new SyncMDDNode(parent->location, parent->theta, parent);
 			parent->children.push_back(node);
+			for (auto it = std::next(copy.levels[i - 1].begin()); it != copy.levels[i - 1].end(); ++it)
+			{
+				node->parents.push_back(*it);
+				(*it)->children.push_back(node);
+			}
 			copy.levels[i].push_back(node);
 
 		}
@@ -38,6 +38,111 @@ void HLNode::updateDistanceToGo()
 	distance_to_go  = (int)(conflicts.size() + conflicting_agents.size()); // while conflicts only store one conflict per pair of agents
 }
 
+static inline uint64_t splitmix64(uint64_t x)
+{
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+static inline uint64_t hashConstraint(const Constraint& constraint, uint64_t seed)
+{
+	uint64_t h = splitmix64(seed ^ (uint64_t)(uint32_t)get<0>(constraint));
+	h = splitmix64(h ^ (uint64_t)(uint32_t)get<1>(constraint));
+	h = splitmix64(h ^ (uint64_t)(uint32_t)get<2>(constraint));
+	h = splitmix64(h ^ (uint64_t)(uint32_t)get<3>(constraint));
+	return splitmix64(h ^ (uint64_t)get<4>(constraint));
+}
+
+ConstraintFingerprint::ConstraintFingerprint(const Constraint& constraint) :
+	lo(hashConstraint(constraint, 0x243f6a8885a308d3ULL)), hi(hashConstraint(constraint, 0x13198a2e03707344ULL)) {}
+
+ConstraintFingerprint AgentFingerprints::get(int agent) const
+{
+	auto node = root.get();
+	int h = height;
+	int shift = 4 * height;
+	if (node == nullptr || (agent >> shift) >= BRANCHES)
+		return ConstraintFingerprint();
+	while (h > 0)
+	{
+		node = node->children[(agent >> shift) & (BRANCHES - 1)].get();
+		if (node == nullptr)
+			return ConstraintFingerprint();
+		h--;
+		shift -= 4;
+	}
+	return node->fps[agent & (BRANCHES - 1)];
+}
+
+void AgentFingerprints::add(int agent, const ConstraintFingerprint& fp)
+{
+	while ((agent >> (4 * height)) >= BRANCHES) // grow the trie
+	{
+		if (root != nullptr)
+		{
+			auto new_root = make_shared<TrieNode>();
+			new_root->children.resize(BRANCHES);
+			new_root->children[0] = root;
+			root = new_root;
+		}
+		height++;
+	}
+	root = add(root, height, agent, fp);
+}
+
+shared_ptr<const AgentFingerprints::TrieNode> AgentFingerprints::add(const shared_ptr<const TrieNode>& node, int height,
+	int agent, const ConstraintFingerprint& fp)
+{
+	auto new_node = (node == nullptr)? make_shared<TrieNode>() : make_shared<TrieNode>(*node);
+	int idx = (agent >> (4 * height)) & (BRANCHES - 1);
+	if (height == 0)
+	{
+		new_node->fps.resize(BRANCHES);
+		new_node->fps[idx] += fp;
+	}
+	else
+	{
+		new_node->children.resize(BRANCHES);
+		new_node->children[idx] = add(new_node->children[idx], height - 1, agent, fp);
+	}
+	return new_node;
+}
+
+void HLNode::updateFingerprints()
+{
+	if (parent == nullptr)
+		return;
+	global_fingerprint = parent->global_fingerprint;
+	agent_fingerprints = parent->agent_fingerprints;
+	if (constraints.empty())
+		return;
+	// as in ConstraintTable::insert2CT, the first constraint decides whom the new constraints are relevant to
+	ConstraintFingerprint fp;
+	for (const auto& constraint : constraints)
+		fp += ConstraintFingerprint(constraint);
+	if (isGlobalConstraint(constraints.front()))
+		global_fingerprint += fp;
+	else
+		agent_fingerprints.add(get<0>(constraints.front()), fp);
+}
+
+#ifdef CHECK_CONSTRAINT_FINGERPRINTS
+set<Constraint> HLNode::collectConstraints(int agent) const
+{
+	set<Constraint> rst;
+	auto curr = this;
+	while (curr->parent != nullptr)
+	{
+		if (isGlobalConstraint(curr->constraints.front()) || get<0>(curr->constraints.front()) == agent)
+			rst.insert(curr->constraints.begin(), curr->constraints.end());
+		curr = curr->parent;
+	}
+	return rst;
+}
+#endif
+
 void HLNode::printConstraints(int id) const
 {
     auto curr = this;
@@ -69,6 +174,25 @@ void HLNode::printConstraints(int id) const
     }
 }
 
+std::ostream& operator<<(std::ostream& os, node_source source)
+{
+	switch (source)
+	{
+	case SOURCE_CLEANUP:
+		os << "cleanup";
+		break;
+	case SOURCE_OPEN:
+		os << "open";
+		break;
+	case SOURCE_FOCAL:
+		os << "focal";
+		break;
+	default:
+		os << "none";
+	}
+	return os;
+}
+
 std::ostream& operator<<(std::ostream& os, const HLNode& node)
 {
 	os << "Node " << node.time_generated << " from " << node.chosen_from << " ( f = "<< node.g_val << " + " <<
@@ -76,4 +200,270 @@ std::ostream& operator<<(std::ostream& os, const HLNode& node)
 		", d = " << node.distance_to_go << " ) with " <<
 		node.getNumNewPaths() << " new paths ";
 	return os;
-}
\ No newline at end of file
+}
+
+
+void* NodeArena::allocate()
+{
+	void* rst;
+	if (free_nodes != nullptr)
+	{
+		rst = free_nodes;
+		free_nodes = *static_cast<void**>(free_nodes);
+	}
+	else
+	{
+		if (used == BLOCK_SIZE)
+		{
+			blocks.push_back(static_cast<char*>(::operator new(BLOCK_SIZE * node_size)));
+			peak_blocks = max(peak_blocks, blocks.size());
+			used = 0;
+		}
+		rst = blocks.back() + used * node_size;
+		used++;
+	}
+	return rst;
+}
+
+void NodeArena::destroy(HLNode* node)
+{
+	node->~HLNode();
+	*reinterpret_cast<void**>(node) = free_nodes;
+	free_nodes = node;
+}
+
+void NodeArena::release(list<HLNode*>& nodes)
+{
+	for (auto node : nodes)
+		node->~HLNode();
+	nodes.clear();
+	releaseBlocks();
+}
+
+void NodeArena::releaseBlocks()
+{
+	for (auto block : blocks)
+		::operator delete(block);
+	blocks.clear();
+	used = BLOCK_SIZE;
+	free_nodes = nullptr;
+}
+
+
+ConflictSet::ConflictSet(const ConflictSet& parent, const list<int>& excluded_agents)
+{
+	if (parent.top == nullptr)
+		return;
+	small_vector<int, 8> agents;
+	for (auto a : excluded_agents)
+	{
+		if (std::find(agents.begin(), agents.end(), a) == agents.end())
+			agents.push_back(a);
+	}
+	// inclusion-exclusion over the excluded agents (a conflict involves two of them at most)
+	num = parent.num;
+	for (size_t i = 0; i < agents.size(); i++)
+	{
+		num -= countAgent(parent.top.get(), agents[i]);
+		for (size_t j = 0; j < i; j++)
+			num += countPair(parent.top.get(), agents[i], agents[j]);
+	}
+	if (num == 0)
+		return;
+	if (num == parent.num) // nothing to hide
+	{
+		top = parent.top;
+		return;
+	}
+	top = make_shared<Layer>();
+	top->excluded.assign(agents.begin(), agents.end());
+	top->base = parent.top;
+	top->depth = parent.top->depth + 1;
+	if (top->depth > MAX_DEPTH)
+		flatten();
+}
+
+ConflictSet::const_iterator ConflictSet::begin() const
+{
+	const_iterator rst;
+	if (top == nullptr)
+		return rst;
+	size_t num_of_layers = top->depth + 1;
+	rst.frames.resize(num_of_layers);
+	small_vector<int, 8> excluded;
+	small_vector<const Tombstones*, 4> removed;
+	size_t i = num_of_layers;
+	for (const Layer* layer = top.get(); layer != nullptr; layer = layer->base.get())
+	{
+		i--;
+		rst.frames[i].layer = layer;
+		rst.frames[i].excluded = excluded;
+		rst.frames[i].removed = removed;
+		excluded.insert(excluded.end(), layer->excluded.begin(), layer->excluded.end());
+		if (!layer->removed.empty())
+			removed.push_back(&layer->removed);
+	}
+	assert(i == 0);
+	rst.it = rst.frames[0].layer->conflicts.begin();
+	rst.skipHidden();
+	return rst;
+}
+
+void ConflictSet::const_iterator::skipHidden()
+{
+	while (frame < frames.size())
+	{
+		if (it == frames[frame].layer->conflicts.end())
+		{
+			frame++;
+			if (frame < frames.size())
+				it = frames[frame].layer->conflicts.begin();
+		}
+		else if (isHidden(**it, frames[frame].excluded, frames[frame].removed))
+			++it;
+		else
+			return;
+	}
+}
+
+const shared_ptr<Conflict>& ConflictSet::back() const
+{
+	assert(!empty());
+	small_vector<int, 8> excluded;
+	small_vector<const Tombstones*, 4> removed;
+	for (const Layer* layer = top.get(); layer != nullptr; layer = layer->base.get())
+	{
+		for (auto it = layer->conflicts.rbegin(); it != layer->conflicts.rend(); ++it)
+		{
+			if (!isHidden(**it, excluded, removed))
+				return *it;
+		}
+		excluded.insert(excluded.end(), layer->excluded.begin(), layer->excluded.end());
+		if (!layer->removed.empty())
+			removed.push_back(&layer->removed);
+	}
+	assert(false);
+	return top->conflicts.back();
+}
+
+void ConflictSet::push_back(const shared_ptr<Conflict>& conflict)
+{
+	if (top == nullptr || top.use_count() > 1)
+		pushLayer();
+	top->conflicts.push_back(conflict);
+	count(*top, *conflict, 1);
+	num++;
+}
+
+void ConflictSet::remove(const shared_ptr<Conflict>& conflict)
+{
+	assert(!empty());
+	if (top.use_count() > 1)
+		pushLayer();
+	auto it = std::find(top->conflicts.begin(), top->conflicts.end(), conflict);
+	if (it != top->conflicts.end())
+		top->conflicts.erase(it);
+	else if (!top->removed.insert(conflict.get()).second) // the conflict is in a shared layer
+		return; // already removed
+	count(*top, *conflict, -1);
+	num--;
+}
+
+uint64_t ConflictSet::pairKey(int a1, int a2)
+{
+	if (a1 > a2)
+		std::swap(a1, a2);
+	return ((uint64_t)(uint32_t)a1 << 32) | (uint32_t)a2;
+}
+
+bool ConflictSet::isHidden(const Conflict& conflict, const small_vector<int, 8>& excluded,
+	const small_vector<const Tombstones*, 4>& removed)
+{
+	for (auto a : excluded)
+	{
+		if (conflict.a1 == a || conflict.a2 == a)
+			return true;
+	}
+	for (auto tombstones : removed)
+	{
+		if (tombstones->find(&conflict) != tombstones->end())
+			return true;
+	}
+	return false;
+}
+
+int ConflictSet::countAgent(const Layer* layer, int agent)
+{
+	int rst = 0;
+	small_vector<int, 8> hidden; // the agents excluded by the layers above
+	for (; layer != nullptr; layer = layer->base.get())
+	{
+		auto p = layer->agent_counts.find(agent);
+		if (p != layer->agent_counts.end())
+			rst += p->second;
+		for (auto a : hidden) // the conflicts with these agents are not visible
+		{
+			auto q = layer->pair_counts.find(pairKey(agent, a));
+			if (q != layer->pair_counts.end())
+				rst -= q->second;
+		}
+		if (std::find(layer->excluded.begin(), layer->excluded.end(), agent) != layer->excluded.end())
+			break;
+		for (auto a : layer->excluded)
+		{
+			if (std::find(hidden.begin(), hidden.end(), a) == hidden.end())
+				hidden.push_back(a);
+		}
+	}
+	return rst;
+}
+
+int ConflictSet::countPair(const Layer* layer, int a1, int a2)
+{
+	int rst = 0;
+	auto key = pairKey(a1, a2);
+	for (; layer != nullptr; layer = layer->base.get())
+	{
+		auto p = layer->pair_counts.find(key);
+		if (p != layer->pair_counts.end())
+			rst += p->second;
+		for (auto a : layer->excluded)
+		{
+			if (a == a1 || a == a2)
+				return rst;
+		}
+	}
+	return rst;
+}
+
+void ConflictSet::count(Layer& layer, const Conflict& conflict, int delta)
+{
+	layer.pair_counts[pairKey(conflict.a1, conflict.a2)] += delta;
+	layer.agent_counts[conflict.a1] += delta;
+	if (conflict.a2 != conflict.a1)
+		layer.agent_counts[conflict.a2] += delta;
+}
+
+void ConflictSet::pushLayer()
+{
+	auto layer = make_shared<Layer>();
+	if (top != nullptr)
+	{
+		layer->base = top;
+		layer->depth = top->depth + 1;
+	}
+	top = layer;
+	if (top->depth > MAX_DEPTH)
+		flatten();
+}
+
+void ConflictSet::flatten()
+{
+	auto layer = make_shared<Layer>();
+	for (const auto& conflict : *this)
+	{
+		layer->conflicts.push_back(conflict);
+		count(*layer, *conflict, 1);
+	}
+	top = layer;
+}
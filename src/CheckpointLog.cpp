@@ -0,0 +1,141 @@
+#include "CheckpointLog.h"
+#include <boost/filesystem.hpp>
+
+
+bool CheckpointLog::create(const string& file_name)
+{
+	out.open(file_name, std::ios::binary | std::ios::trunc);
+	bytes_written = 0;
+	return out.is_open();
+}
+
+bool CheckpointLog::append(const string& file_name, uint64_t length)
+{
+	boost::system::error_code error;
+	boost::filesystem::resize_file(file_name, length, error); // drop the records after the last checkpoint
+	if (error)
+		return false;
+	out.open(file_name, std::ios::binary | std::ios::app);
+	bytes_written = length;
+	return out.is_open();
+}
+
+void CheckpointLog::close()
+{
+	out.close();
+	in.close();
+}
+
+void CheckpointLog::putConstraints(const ConstraintList& constraints)
+{
+	put((uint32_t)constraints.size());
+	for (const auto& constraint : constraints)
+	{
+		put((int32_t)std::get<0>(constraint));
+		put((int32_t)std::get<1>(constraint));
+		put((int32_t)std::get<2>(constraint));
+		put((int32_t)std::get<3>(constraint));
+		put((uint8_t)std::get<4>(constraint));
+	}
+}
+
+void CheckpointLog::putPath(const Path& path, const Path& base)
+{
+	size_t prefix = 0;
+	while (prefix < path.size() && prefix < base.size() &&
+		path[prefix].location == base[prefix].location && path[prefix].theta == base[prefix].theta)
+		prefix++;
+	put((uint32_t)prefix);
+	put((uint32_t)(path.size() - prefix));
+	for (size_t t = prefix; t < path.size(); t++)
+	{
+		put((int32_t)path[t].location);
+		put(path[t].theta);
+	}
+}
+
+void CheckpointLog::write(record_type type)
+{
+	auto size = (uint32_t)record.size();
+	out.put((char)type);
+	out.write((const char*)&size, sizeof(size));
+	out.write(record.data(), record.size());
+	bytes_written += 1 + sizeof(size) + record.size();
+	record.clear();
+	if (type == CHECKPOINT)
+		out.flush();
+}
+
+bool CheckpointLog::open(const string& file_name)
+{
+	in.open(file_name, std::ios::binary);
+	if (!in.is_open())
+		return false;
+	in.seekg(0, std::ios::end);
+	auto file_size = (uint64_t)in.tellg();
+	in.seekg(0);
+	// skip through the records to the end of the last complete CHECKPOINT record
+	length = 0;
+	uint64_t offset = 0;
+	char t;
+	uint32_t size;
+	while (offset + 1 + sizeof(size) <= file_size && in.get(t) && in.read((char*)&size, sizeof(size)))
+	{
+		offset += 1 + sizeof(size) + size;
+		if (offset > file_size) // cut short
+			break;
+		if ((record_type)t == CHECKPOINT)
+			length = offset;
+		in.seekg(offset);
+	}
+	in.clear();
+	in.seekg(0);
+	bytes_read = 0;
+	return length > 0;
+}
+
+bool CheckpointLog::next()
+{
+	if (bytes_read >= length)
+		return false;
+	char t;
+	uint32_t size;
+	in.get(t);
+	in.read((char*)&size, sizeof(size));
+	record.resize(size);
+	in.read(&record[0], size);
+	bytes_read += 1 + sizeof(size) + size;
+	type = (record_type)t;
+	pos = 0;
+	return (bool)in;
+}
+
+void CheckpointLog::getConstraints(ConstraintList& constraints)
+{
+	constraints.clear();
+	int n = get<uint32_t>();
+	for (int i = 0; i < n; i++)
+	{
+		int a = get<int32_t>();
+		int x = get<int32_t>();
+		int y = get<int32_t>();
+		int t = get<int32_t>();
+		auto c = (constraint_type)get<uint8_t>();
+		constraints.emplace_back(a, x, y, t, c);
+	}
+}
+
+void CheckpointLog::getPath(Path& path, const Path& base)
+{
+	size_t prefix = get<uint32_t>();
+	size_t rest = get<uint32_t>();
+	assert(prefix <= base.size());
+	path.assign(base.begin(), base.begin() + prefix);
+	path.reserve(prefix + rest);
+	for (size_t t = 0; t < rest; t++)
+	{
+		int loc = get<int32_t>();
+		double theta = get<double>();
+		path.emplace_back(loc, theta);
+	}
+}
@@ -1,4 +1,5 @@
 #include "ConstraintTable.h"
+#include "MoveInterference.h"
 
 int ConstraintTable::getMaxTimestep() const // everything is static after the max timestep
 {
@@ -50,7 +51,7 @@ void ConstraintTable::insert2CT(const HLNode& node, int agent)
     }
 }
 // add constraints for the given agent
-void ConstraintTable::insert2CT(const list<Constraint>& constraints, int agent)
+void ConstraintTable::insert2CT(const ConstraintList& constraints, int agent)
 {
     if (constraints.empty())
         return;
@@ -145,7 +146,7 @@ void ConstraintTable::insert2CT(const Path& path)
         if (prev_location != curr_location)
         {
             insert2CT(prev_location, prev_timestep, timestep); // add vertex conflict
-            insert2CT(curr_location, prev_location, timestep, timestep + 1); // add edge conflict
+            insert2CT(prev_location, curr_location, timestep, timestep + 1); // add edge conflict (blocks the swaps and crossings of the move)
             prev_location = curr_location;
             prev_timestep = timestep;
         }
@@ -253,51 +254,21 @@ bool ConstraintTable::constrained(size_t loc, int t) const
 }
 bool ConstraintTable::constrained(size_t curr_loc, size_t next_loc, int next_t) const
 {
-    // cout << "\nEdge collision checking!";
-    //same edge:
-    // cout << "Same edge id: " << getEdgeIndex(curr_loc, next_loc);
-    if(constrained(getEdgeIndex(curr_loc, next_loc), next_t)){
+    if (constrained(getEdgeIndex(curr_loc, next_loc), next_t))
         return true;
-    }
-
-    // cout << "\nDiagonal collision";
-    //apart from same edge I also need to check the diagonal edge
-    vector<int> n;
-    int sum = curr_loc + next_loc;
-    n.push_back(curr_loc-1);
-    n.push_back(curr_loc+1);
-    n.push_back(curr_loc-num_col);
-    n.push_back(curr_loc+num_col);
 
-    for(int i=0;i<n.size();i++){
-        int end = sum - n[i];
-        if(end < 0 || end == n[i]){
+    // an edge constraint also blocks the moves that interfere with the constrained move for some headings (swaps and crossings)
+    int num_of_rows = (int)(map_size / num_col);
+    int row = (int)(curr_loc / num_col), col = (int)(curr_loc % num_col);
+    for (const auto& move : MoveInterference::getInterferingMoves((int)curr_loc, (int)next_loc, (int)num_col))
+    {
+        int from_row = row + move.offset_row, from_col = col + move.offset_col;
+        int to_row = from_row + move.step_row, to_col = from_col + move.step_col;
+        if (from_row < 0 || from_row >= num_of_rows || from_col < 0 || from_col >= (int)num_col ||
+            to_row < 0 || to_row >= num_of_rows || to_col < 0 || to_col >= (int)num_col)
             continue;
-        }
-        else{
-            int loc1_x = n[i] / num_col;
-			int loc1_y = n[i] % num_col;
-			int loc2_x = end / num_col;
-			int loc2_y = end % num_col;
-
-			if(abs(loc1_x - loc2_x) + abs(loc1_y - loc2_y) > 2){
-                continue;
-            }
-            size_t edge_id = (1+n[i])*map_size + end;
-            // cout << "\nChecking edge_id: " << edge_id;
-            const auto& it = ct.find(edge_id);
-            if (it == ct.end())
-            {
-                return false;
-            }
-            for (const auto& constraint: it->second) //If the constraint exists and the timestep falls in the time interval of the constraint then return true
-            {
-                if (constraint.first <= next_t && next_t < constraint.second){
-                    // cout << "\nFound diagonal collision!";
-                    return true;
-                }
-            }
-        }
+        if (constrained(getEdgeIndex(from_row * num_col + from_col, to_row * num_col + to_col), next_t))
+            return true;
     }
     return false;
 }
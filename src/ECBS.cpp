@@ -1,11 +1,14 @@
+#include <thread>
+#include <atomic>
 #include "ECBS.h"
 
 
-bool ECBS::solve(double time_limit, int _cost_lowerbound)
+bool ECBS::solve(double time_limit, int _cost_lowerbound, int _cost_upperbound)
 {
 	cout << "\nInside ECBS solve";
 	this->cost_lowerbound = _cost_lowerbound; //lowest f value in the open list
 	this->inadmissible_cost_lowerbound = 0; //top fhat value
+	this->cost_upperbound = _cost_upperbound;
 	this->time_limit = time_limit;
 
 	if (screen > 0) // 1 or 2
@@ -15,35 +18,58 @@ bool ECBS::solve(double time_limit, int _cost_lowerbound)
 		cout << name << ": ";
 	}
 	// set timer
-	start = clock();
+	start = std::chrono::steady_clock::now();
 
-	generateRoot();
+	if (!resume_from_checkpoint || !loadCheckpoint())
+	{
+		if (!checkpoint_file.empty())
+			createCheckpoint();
+		generateRoot();
+	}
 	// cout << "\ngenerated root!";
 
 	while (!cleanup_list.empty() && !solution_found)
 	{
+		if (checkpoint.isOpen() && getRuntime() >= last_checkpoint + checkpoint_interval)
+			writeCheckpoint();
+		if (expansion_batch > 1)
+		{
+			if (expandNodes())
+				return solution_found;
+			continue;
+		}
 		auto curr = selectNode();
 		// cout << "\npopped current HL node";
-		if (terminate(curr))
+		if (curr == nullptr || skipStaleGoal(curr))
+			continue;
+		if (terminate(curr, anytime))
+		{
+			if (resumeSearch())
+				continue;
+			if (!solution_found && checkpoint.isOpen())
+				writeCheckpoint(); // curr is not closed in the log, so a resumed search selects it again
 			return solution_found;
+		}
 		cout << "\nSolution not found yet";
 
-		if ((curr == dummy_start || curr->chosen_from == "cleanup") &&
+		if ((curr == dummy_start || curr->chosen_from == SOURCE_CLEANUP) &&
 		     !curr->h_computed) // heuristics has not been computed yet
 		{
             cout << "\nCurrent node chosen from cleanup";
-			runtime = (double)(clock() - start) / CLOCKS_PER_SEC;
+			runtime = getRuntime();
 			cout << "\nGoing to cal inf heuristics";
             bool succ = heuristic_helper.computeInformedHeuristics(*curr, min_f_vals, time_limit - runtime);
 			cout << "\nCalculated informed heuristic";
-            runtime = (double)(clock() - start) / CLOCKS_PER_SEC;
+            runtime = getRuntime();
             if (!succ) // no solution, so prune this node
             {
                 if (screen > 1)
                     cout << "	Prune " << *curr << endl;
+                logEvent(*curr, CheckpointLog::CLOSE);
                 curr->clear();
                 continue;
             }
+            logValues(*curr);
 
             if (reinsertNode(curr))
                 continue;
@@ -57,17 +83,27 @@ bool ECBS::solve(double time_limit, int _cost_lowerbound)
 		//Expand the node
 		num_HL_expanded++;
 		curr->time_expanded = num_HL_expanded;
-		if (bypass && curr->chosen_from != "cleanup")
+		logEvent(*curr, CheckpointLog::CLOSE);
+		if (merge_threshold > 0 && mergeAgents(curr))
+		{
+			// expanded into the child with the merged meta-agent
+		}
+		else if (bypass && curr->chosen_from != SOURCE_CLEANUP)
 		{
 			cout << "\nbypassin!";
 			bool foundBypass = true;
 			while (foundBypass)
 			{
-				if (terminate(curr))
-					return solution_found;
+				if (terminate(curr, anytime))
+				{
+					if (!resumeSearch())
+						return solution_found;
+					break; // the bypasses made curr the new incumbent
+				}
 				foundBypass = false;
-				ECBSNode* child[2] = { new ECBSNode() , new ECBSNode() };
-				curr->conflict = chooseConflict(*curr);
+				ECBSNode* child[2] = { node_arena.create<ECBSNode>() , node_arena.create<ECBSNode>() };
+				if (curr->conflict == nullptr) // not chosen by mergeAgents, or reset by adoptBypass
+					curr->conflict = chooseConflict(*curr);
 				addConstraints(curr, child[0], child[1]);
 				if (screen > 1)
 					cout << "	Expand " << *curr << endl << 	"	on " << *(curr->conflict) << endl;
@@ -75,6 +111,8 @@ bool ECBS::solve(double time_limit, int _cost_lowerbound)
 				bool solved[2] = { false, false };
 				vector<vector<PathEntry>*> path_copy(paths);
 				vector<int> fmin_copy(min_f_vals);
+				ChildPaths child_paths[2];
+				bool replanned = replanChildren(child, curr, child_paths);
 				for (int i = 0; i < 2; i++)
 				{
 					if (i > 0)
@@ -82,10 +120,10 @@ bool ECBS::solve(double time_limit, int _cost_lowerbound)
 						paths = path_copy;
 						min_f_vals = fmin_copy;
 					}
-					solved[i] = generateChild(child[i], curr);
+					solved[i] = replanned ? finishChild(child[i], child_paths[i]) : generateChild(child[i], curr);
 					if (!solved[i])
 					{
-						delete (child[i]);
+						discardNode(child[i]);
 						continue;
 					}
 					else if (i == 1 && !solved[0])
@@ -111,6 +149,7 @@ bool ECBS::solve(double time_limit, int _cost_lowerbound)
 						if (foundBypass)
 						{
 							adoptBypass(curr, child[i], fmin_copy);
+							logNode(*curr, CheckpointLog::PATHS);
 							if (screen > 1)
 								cout << "	Update " << *curr << endl;
 							break;
@@ -121,7 +160,7 @@ bool ECBS::solve(double time_limit, int _cost_lowerbound)
 				{
 					for (auto & i : child)
 					{
-						delete i;
+						discardNode(i);
 					}
                     classifyConflicts(*curr); // classify the new-detected conflicts
 				}
@@ -145,8 +184,9 @@ bool ECBS::solve(double time_limit, int _cost_lowerbound)
 		else // no bypass
 		{
 			cout << "\nNo bypass!";
-			ECBSNode* child[2] = { new ECBSNode() , new ECBSNode() };
-			curr->conflict = chooseConflict(*curr);
+			ECBSNode* child[2] = { node_arena.create<ECBSNode>() , node_arena.create<ECBSNode>() };
+			if (curr->conflict == nullptr) // not chosen by mergeAgents
+				curr->conflict = chooseConflict(*curr);
 			cout << "\nConflict chosen";
 			addConstraints(curr, child[0], child[1]);
 			cout << "\nConstraint added";
@@ -157,6 +197,8 @@ bool ECBS::solve(double time_limit, int _cost_lowerbound)
 			bool solved[2] = { false, false };
 			vector<vector<PathEntry>*> path_copy(paths);
 			vector<int> fmin_copy(min_f_vals);
+			ChildPaths child_paths[2];
+			bool replanned = replanChildren(child, curr, child_paths);
 			for (int i = 0; i < 2; i++)
 			{
 				if (i > 0)
@@ -164,10 +206,10 @@ bool ECBS::solve(double time_limit, int _cost_lowerbound)
 					paths = path_copy;
 					min_f_vals = fmin_copy;
 				}
-				solved[i] = generateChild(child[i], curr);
+				solved[i] = replanned ? finishChild(child[i], child_paths[i]) : generateChild(child[i], curr);
 				if (!solved[i])
 				{
-					delete (child[i]);
+					discardNode(child[i]);
 					continue;
 				}
 				pushNode(child[i]);
@@ -176,6 +218,8 @@ bool ECBS::solve(double time_limit, int _cost_lowerbound)
 					cout << "		Generate " << *child[i] << endl;
 			}
 		}
+		if (curr->conflict == nullptr) // curr is the new incumbent
+			continue;
 		switch (curr->conflict->type)
 		{
 		case conflict_type::RECTANGLE:
@@ -196,11 +240,11 @@ bool ECBS::solve(double time_limit, int _cost_lowerbound)
 		default:
 			break;
 		}
-		if (curr->chosen_from == "cleanup")
+		if (curr->chosen_from == SOURCE_CLEANUP)
 			num_cleanup++;
-		else if (curr->chosen_from == "open")
+		else if (curr->chosen_from == SOURCE_OPEN)
 			num_open++;
-		else if (curr->chosen_from == "focal")
+		else if (curr->chosen_from == SOURCE_FOCAL)
 			num_focal++;
 		if (curr->conflict->priority == conflict_priority::CARDINAL)
 			num_cardinal_conflicts++;
@@ -209,12 +253,210 @@ bool ECBS::solve(double time_limit, int _cost_lowerbound)
 		curr->clear();
 	}  // end of while loop
 
+	resumeSearch(); // anytime: every node left was pruned, so restore the best solution
 	return solution_found;
 }
 
+// Anytime mode: each new solution is recorded and passed to solution_callback, and the search goes on with the
+// same CT, tables and caches for a cheaper one. The suboptimality is lowered to (cost - 0.5) / lower bound
+// (or 1), so every later solution improves on the incumbent. The search stops when the lower bound reaches
+// the cost of the incumbent or the time is out, and then the incumbent is restored as the solution.
+bool ECBS::resumeSearch()
+{
+	if (!anytime)
+	{
+		if (best_effort && !solution_found)
+			takeBestEffortPlan();
+		return false;
+	}
+	if (solution_found)
+	{
+		auto goal = static_cast<ECBSNode*>(goal_node);
+		assert(incumbent == nullptr || goal->sum_of_costs < incumbent->sum_of_costs); // see skipStaleGoal
+		incumbent = goal;
+		cost_upperbound = solution_cost;
+		if (solution_callback)
+			solution_callback();
+		solution_found = false;
+		if (cost_lowerbound < incumbent->sum_of_costs)
+		{
+			suboptimality = max(1.0, (incumbent->sum_of_costs - 0.5) / cost_lowerbound);
+			pruneNodes();
+			if (!refineGoal(goal)) // no cheaper solutions are looked for below it
+				solved_min_f = min(solved_min_f, goal->getFVal());
+			if (screen > 1)
+				cout << "Look for a solution below " << incumbent->sum_of_costs << " with suboptimality " << suboptimality << endl;
+			return true;
+		}
+	}
+	if (incumbent != nullptr)
+	{
+		if (cleanup_list.empty()) // all other nodes were pruned
+			cost_lowerbound = max(cost_lowerbound, min(incumbent->sum_of_costs, solved_min_f));
+		cost_lowerbound = min(cost_lowerbound, incumbent->sum_of_costs);
+		solution_found = true;
+		goal_node = incumbent;
+		solution_cost = incumbent->sum_of_costs;
+		updatePaths(incumbent);
+	}
+	if (screen > 0)
+		printResults();
+	if (incumbent == nullptr && best_effort)
+		takeBestEffortPlan();
+	return false;
+}
+
+void ECBS::pruneNodes()
+{
+	vector<ECBSNode*> nodes;
+	for (auto node : cleanup_list)
+	{
+		if (node->getFVal() < incumbent->sum_of_costs)
+			nodes.push_back(node);
+		else // never selected again
+			retireNode(node);
+	}
+	cleanup_list.clear();
+	open_list.clear();
+	focal_list.clear();
+	inadmissible_cost_lowerbound = 0; // EES rebuilds FOCAL in the next selectNode
+	for (auto node : nodes)
+		insertNode(node);
+}
+
+// The paths of a goal node are only as good as the suboptimality they were planned with, so cheaper solutions
+// may satisfy the same constraints. A child with no new constraints, in which the agents whose paths exceed
+// the current bound are replanned, stands for them in the search. Path lengths are not bounded by the min f of
+// the low level on lattices, so a refinement is not refined again. Returns false if the goal is not refined.
+bool ECBS::refineGoal(ECBSNode* goal)
+{
+	if (goal->parent != nullptr && goal->constraints.empty()) // a refinement itself
+		return false;
+	set<int> agents;
+	for (int i = 0; i < num_of_agents; i++)
+	{
+		if ((int)paths[i]->size() - 1 > suboptimality * min_f_vals[i])
+			agents.insert(i);
+	}
+	if (agents.empty())
+		return false;
+	auto child = node_arena.create<ECBSNode>();
+	initChild(child, goal);
+	if (!replanAgents(child, agents, paths, min_f_vals, num_of_threads))
+	{
+		discardNode(child);
+		return false;
+	}
+	findConflicts(*child);
+	heuristic_helper.computeQuickHeuristics(*child);
+	pushNode(child);
+	goal->children.push_back(child);
+	if (screen > 1)
+		cout << "		Refine " << *child << endl;
+	return true;
+}
+
+// A goal node whose paths were planned before the last solution may be no cheaper than the incumbent,
+// so instead of a solution it is replaced by its refinement.
+bool ECBS::skipStaleGoal(ECBSNode* node)
+{
+	if (incumbent == nullptr || node->sum_of_costs < incumbent->sum_of_costs ||
+		!node->conflicts.empty() || !node->unknownConf.empty())
+		return false;
+	if (!refineGoal(node))
+		solved_min_f = min(solved_min_f, node->getFVal());
+	return true;
+}
+
+// Best effort: if the number of conflicts of the best node is not projected to reach zero by the cutoff time,
+// at the rate it has dropped from the root so far, the suboptimality is raised by 10% so that FOCAL admits more
+// nodes and the low level returns paths sooner. This is checked once every 5% of the time limit.
+void ECBS::adaptSuboptimality()
+{
+	double now = getRuntime();
+	if (incumbent != nullptr || best_effort_node == nullptr || now < last_adaptation + time_limit / 20)
+		return;
+	last_adaptation = now;
+	int remaining = best_effort_node->distance_to_go;
+	int resolved = dummy_start->distance_to_go - remaining;
+	if (remaining > 0 && (resolved <= 0 || now + remaining * now / resolved > time_limit))
+	{
+		suboptimality *= 1.1;
+		rebuildFocal();
+		if (screen > 1)
+			cout << "Raise the suboptimality to " << suboptimality << " with " << remaining << " conflicts left" << endl;
+	}
+}
+
+void ECBS::rebuildFocal()
+{
+	focal_list.clear();
+	switch (solver_type)
+	{
+	case high_level_solver_type::ASTAREPS:
+		for (auto n : cleanup_list)
+		{
+			if (n->sum_of_costs <= suboptimality * cost_lowerbound)
+				n->focal_handle = focal_list.push(n);
+		}
+		break;
+	case high_level_solver_type::NEW:
+		for (auto n : cleanup_list)
+		{
+			if (n->getFHatVal() <= suboptimality * cost_lowerbound)
+				n->focal_handle = focal_list.push(n);
+		}
+		break;
+	case high_level_solver_type::EES:
+		for (auto n : open_list)
+		{
+			if (n->getFHatVal() <= suboptimality * inadmissible_cost_lowerbound)
+				n->focal_handle = focal_list.push(n);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+// The conflicts of expanded nodes are dropped, so they are detected again on a scratch node.
+void ECBS::takeBestEffortPlan()
+{
+	if (best_effort_node == nullptr)
+		return;
+	updatePaths(best_effort_node);
+	if (best_effort_node->isRetired())
+		regenerateNode(best_effort_node); // if it is pruned, the plan falls back on the paths of its ancestors
+	ECBSNode scratch;
+	scratch.parent = nullptr;
+	scratch.HLNode::parent = nullptr;
+	findAllConflicts(scratch);
+	remaining_conflicts = scratch.unknownConf;
+	num_remaining_conflicts = remaining_conflicts.size();
+	best_effort_plan = true;
+	if (screen > 0)
+	{
+		set<int> agents;
+		for (const auto& conflict : remaining_conflicts)
+		{
+			agents.insert(conflict->a1);
+			agents.insert(conflict->a2);
+		}
+		cout << "Best effort: " << remaining_conflicts.size() << " conflicts among " << agents.size() << " agents, cost " <<
+			best_effort_node->sum_of_costs << endl;
+	}
+}
+
+inline void ECBS::tightenSuboptimality()
+{
+	if (incumbent != nullptr && suboptimality * cost_lowerbound > incumbent->sum_of_costs - 0.5)
+		suboptimality = max(1.0, (incumbent->sum_of_costs - 0.5) / cost_lowerbound);
+}
+
 void ECBS::adoptBypass(ECBSNode* curr, ECBSNode* child, const vector<int>& fmin_copy)
 {
 	num_adopt_bypass++;
+	hl_memory -= getPathBytes(*curr);
 	curr->sum_of_costs = child->sum_of_costs;
 	curr->cost_to_go = child->cost_to_go;
 	curr->distance_to_go = child->distance_to_go;
@@ -231,6 +473,7 @@ void ECBS::adoptBypass(ECBSNode* curr, ECBSNode* child, const vector<int>& fmin_
 			{
 				p->second.first = path.second.first;
 				paths[p->first] = &p->second.first;
+				occupancy.invalidate(p->first); // changed in place
                 min_f_vals[p->first] = p->second.second;
 				break;
 			}
@@ -244,6 +487,7 @@ void ECBS::adoptBypass(ECBSNode* curr, ECBSNode* child, const vector<int>& fmin_
 			min_f_vals[path.first] = fmin_copy[path.first];
 		}
 	}
+	hl_memory += getPathBytes(*curr);
 }
 
 // takes the paths_found_initially and UPDATE all (constrained) paths found for agents from curr to start
@@ -276,35 +520,20 @@ void ECBS::updatePaths(ECBSNode* curr)
 
 bool ECBS::generateRoot()
 {
-	auto root = new ECBSNode(); //High level node
+	auto root = node_arena.create<ECBSNode>(); //High level node
 	root->g_val = 0;
 	root->sum_of_costs = 0;
-	paths.resize(num_of_agents, nullptr);
 	cout << "\nNumber of agents in ECBS: " << num_of_agents << endl;
-	min_f_vals.resize(num_of_agents);
-	mdd_helper.init(num_of_agents); //Initialize MDD and CBS lookup table for the agents
-	heuristic_helper.init();
-
-	// initialize paths_found_initially
-	assert(paths_found_initially.empty());
-	paths_found_initially.resize(num_of_agents);
+	initTables();
+	if (parallel_root)
+		planRootInWaves(root);
 	//generate random permutation of agent indices
-	auto agents = shuffleAgents();
+	auto agents = parallel_root ? vector<int>() : shuffleAgents();
 
 	for (auto i : agents)
 	{
 		//search_engine can be SIPP or SpaceTimeAstar, latter by default
-		paths_found_initially[i] = search_engines[i]->findSuboptimalPath(*root, initial_constraints[i], paths, i, 0, suboptimality);
-		if (paths_found_initially[i].first.empty())
-		{
-			cerr << "The start-goal locations of agent " << i << "are not connected" << endl;
-			exit(-1);
-		}
-		paths[i] = &paths_found_initially[i].first;
-		min_f_vals[i] = paths_found_initially[i].second;
-		root->makespan = max(root->makespan, paths[i]->size() - 1);
-		root->g_val += min_f_vals[i];
-		root->sum_of_costs += (int)paths[i]->size() - 1;
+		addRootPath(root, i, search_engines[i]->findSuboptimalPath(*root, initial_constraints[i], paths, i, 0, suboptimality));
 		num_LL_expanded += search_engines[i]->num_expanded;
 		num_LL_generated += search_engines[i]->num_generated;
 		cout << "\n**********************One agent done*****************";
@@ -313,9 +542,20 @@ bool ECBS::generateRoot()
 	root->h_val = 0;
 	root->depth = 0;
 	findConflicts(*root);
+	num_root_conflicts = root->unknownConf.size();
     heuristic_helper.computeQuickHeuristics(*root);
+	if (checkpoint.isOpen())
+	{
+		for (const auto& path : paths_found_initially)
+		{
+			checkpoint.put((int32_t)path.second);
+			checkpoint.putPath(path.first, Path());
+		}
+		checkpoint.write(CheckpointLog::ROOT);
+	}
 	pushNode(root);
 	dummy_start = root;
+	runtime_generate_root = getRuntime();
 
 	if (screen >= 2) // print start and goals
 		printPaths();
@@ -323,29 +563,183 @@ bool ECBS::generateRoot()
 	return true;
 }
 
+void ECBS::initTables()
+{
+	paths.resize(num_of_agents, nullptr);
+	occupancy.reset(search_engines[0]->instance.map_size, search_engines[0]->instance.num_of_cols);
+	min_f_vals.resize(num_of_agents);
+	mdd_helper.init(num_of_agents); //Initialize MDD and CBS lookup table for the agents
+	heuristic_helper.init();
+
+	// initialize paths_found_initially
+	assert(paths_found_initially.empty());
+	paths_found_initially.resize(num_of_agents);
+}
+
+
+// Plan the root in waves. The agents are ordered by increasing heuristic distance (or randomly for random restarts),
+// as short paths planned first are avoided by the longer ones, and each agent joins the first wave whose corridors
+// do not overlap its own. The agents of a wave are planned
+// concurrently against the paths of the previous waves, and their paths are added in the order of the wave,
+// so the root does not depend on the number of threads.
+void ECBS::planRootInWaves(ECBSNode* root)
+{
+	auto order = shuffleAgents();
+	if (!randomRoot)
+	{
+		std::stable_sort(order.begin(), order.end(), [&](int a1, int a2)
+		{
+			return search_engines[a1]->my_heuristic[search_engines[a1]->start_location] <
+				search_engines[a2]->my_heuristic[search_engines[a2]->start_location];
+		});
+	}
+	vector<vector<int>> waves;
+	vector<vector<bool>> occupied; // the cells of the corridors in each wave
+	for (auto agent : order)
+	{
+		auto corridor = getCorridor(agent);
+		size_t w = 0;
+		for (; w < waves.size(); w++)
+		{
+			bool overlap = false;
+			for (auto loc : corridor)
+			{
+				if (occupied[w][loc])
+				{
+					overlap = true;
+					break;
+				}
+			}
+			if (!overlap)
+				break;
+		}
+		if (w == waves.size())
+		{
+			waves.emplace_back();
+			occupied.emplace_back(search_engines[agent]->instance.map_size, false);
+		}
+		waves[w].push_back(agent);
+		for (auto loc : corridor)
+			occupied[w][loc] = true;
+	}
+	num_root_waves = waves.size();
+
+	for (const auto& wave : waves)
+	{
+		vector<pair<Path, int>> new_paths(wave.size());
+		parallelFor(wave.size(), num_of_threads, [&](size_t i)
+		{
+			new_paths[i] = searchPath(root, wave[i], paths, 0);
+		});
+		for (size_t j = 0; j < wave.size(); j++)
+			addRootPath(root, wave[j], new_paths[j]);
+	}
+}
+
+// whether the root is planned in waves or one agent after another, its g-value is the sum of the lower bounds
+// returned by the low-level search, which bound the path lengths within the sub-optimality factor
+void ECBS::addRootPath(ECBSNode* root, int agent, const pair<Path, int>& path)
+{
+	paths_found_initially[agent] = path;
+	if (paths_found_initially[agent].first.empty())
+	{
+		cerr << "The start-goal locations of agent " << agent << "are not connected" << endl;
+		exit(-1);
+	}
+	paths[agent] = &paths_found_initially[agent].first;
+	min_f_vals[agent] = paths_found_initially[agent].second;
+	root->makespan = max(root->makespan, paths[agent]->size() - 1);
+	root->g_val += min_f_vals[agent];
+	root->sum_of_costs += (int)paths[agent]->size() - 1;
+}
+
+vector<int> ECBS::getCorridor(int agent) const
+{
+	const auto& engine = *search_engines[agent];
+	int loc = engine.start_location;
+	vector<int> corridor(1, loc);
+	while (loc != engine.goal_location)
+	{
+		int next = loc;
+		for (auto neighbor : engine.instance.get_eight_Neighbors(loc))
+		{
+			if (engine.my_heuristic[neighbor] < engine.my_heuristic[next])
+				next = neighbor;
+		}
+		if (next == loc) // local minimum of the lattice heuristic
+			break;
+		loc = next;
+		corridor.push_back(loc);
+	}
+	if (loc != engine.goal_location)
+		corridor.push_back(engine.goal_location);
+	return corridor;
+}
+
 
 bool ECBS::generateChild(ECBSNode*  node, ECBSNode* parent)
 {
 	clock_t t1 = clock();
+	initChild(node, parent);
+	auto agents = getInvalidAgents(node->constraints);
+	assert(!agents.empty());
+	if (!replanAgents(node, agents, paths, min_f_vals, num_of_threads))
+	{
+		runtime_generate_child += (double)(clock() - t1) / CLOCKS_PER_SEC;
+		return false;
+	}
+
+	findConflicts(*node);
+	heuristic_helper.computeQuickHeuristics(*node);
+	runtime_generate_child += (double)(clock() - t1) / CLOCKS_PER_SEC;
+	return true;
+}
+
+void ECBS::initChild(ECBSNode*  node, ECBSNode* parent)
+{
 	node->parent = parent;
 	node->HLNode::parent = parent;
 	node->g_val = parent->g_val;
 	node->sum_of_costs = parent->sum_of_costs;
 	node->makespan = parent->makespan;
 	node->depth = parent->depth + 1;
-	auto agents = getInvalidAgents(node->constraints);
-	assert(!agents.empty());
-	for (auto agent : agents)
+	node->updateFingerprints();
+}
+
+bool ECBS::replanChildren(ECBSNode* child[2], ECBSNode* parent, ChildPaths rst[2])
+{
+	set<int> agents[2];
+	if (num_of_threads < 2 || !getChildrenAgents(child[0], child[1], agents))
+		return false;
+	clock_t t1 = clock();
+	for (int i = 0; i < 2; i++)
 	{
-		if (!findPathForSingleAgent(node, agent))
-		{
-            if (screen > 1)
-                cout << "	No paths for agent " << agent << ". Node pruned." << endl;
-			runtime_generate_child += (double)(clock() - t1) / CLOCKS_PER_SEC;
-			return false;
-		}
+		initChild(child[i], parent);
+		rst[i].paths = paths;
+		rst[i].min_f_vals = min_f_vals;
 	}
+	auto replan = [&](int i)
+	{
+		rst[i].solved = replanAgents(child[i], agents[i], rst[i].paths, rst[i].min_f_vals, max(1, num_of_threads / 2));
+	};
+	std::thread worker(replan, 1);
+	replan(0);
+	worker.join();
+	runtime_generate_child += (double)(clock() - t1) / CLOCKS_PER_SEC;
+	return true;
+}
 
+bool ECBS::finishChild(ECBSNode* node, ChildPaths& child_paths)
+{
+	if (!child_paths.solved)
+	{
+		if (screen > 1)
+			cout << "	No paths for some agent. Node pruned." << endl;
+		return false;
+	}
+	clock_t t1 = clock();
+	paths = child_paths.paths;
+	min_f_vals = child_paths.min_f_vals;
 	findConflicts(*node);
 	heuristic_helper.computeQuickHeuristics(*node);
 	runtime_generate_child += (double)(clock() - t1) / CLOCKS_PER_SEC;
@@ -353,32 +747,399 @@ bool ECBS::generateChild(ECBSNode*  node, ECBSNode* parent)
 }
 
 
-bool ECBS::findPathForSingleAgent(ECBSNode*  node, int ag)
+bool ECBS::expandNodes()
+{
+	vector<ECBSNode*> batch;
+	vector<ECBSNode*> children; // children[2 * i] and children[2 * i + 1] are the children of batch[i]
+	vector<set<int>> agents; // the agents to replan for each child
+	vector<ChildPaths> child_paths;
+	int inflight_min_f = MAX_COST;
+	while ((int)batch.size() < expansion_batch && !cleanup_list.empty())
+	{
+		if (!batch.empty() && focal_list.empty())
+			break; // the rest of FOCAL is being expanded
+		auto curr = selectNode(inflight_min_f);
+		if (curr == nullptr || skipStaleGoal(curr))
+			continue;
+		if (terminate(curr, anytime))
+		{
+			if (resumeSearch())
+				continue;
+			for (auto child : children)
+				discardNode(child);
+			return true;
+		}
+		if ((curr == dummy_start || curr->chosen_from == SOURCE_CLEANUP) &&
+			!curr->h_computed) // heuristics has not been computed yet
+		{
+			runtime = getRuntime();
+			bool succ = heuristic_helper.computeInformedHeuristics(*curr, min_f_vals, time_limit - runtime);
+			runtime = getRuntime();
+			if (!succ) // no solution, so prune this node
+			{
+				if (screen > 1)
+					cout << "	Prune " << *curr << endl;
+				logEvent(*curr, CheckpointLog::CLOSE);
+				curr->clear();
+				continue;
+			}
+			logValues(*curr);
+			if (reinsertNode(curr))
+				continue;
+		}
+		classifyConflicts(*curr);
+		num_HL_expanded++;
+		curr->time_expanded = num_HL_expanded;
+		logEvent(*curr, CheckpointLog::CLOSE);
+		curr->conflict = chooseConflict(*curr);
+		ECBSNode* child[2] = { node_arena.create<ECBSNode>() , node_arena.create<ECBSNode>() };
+		addConstraints(curr, child[0], child[1]);
+		if (screen > 1)
+			cout << "	Expand " << *curr << endl << "	on " << *(curr->conflict) << endl;
+		for (auto & i : child)
+		{
+			initChild(i, curr);
+			children.push_back(i);
+			agents.push_back(getInvalidAgents(i->constraints));
+			child_paths.emplace_back();
+			child_paths.back().paths = paths; // the view of curr, set by selectNode
+			child_paths.back().min_f_vals = min_f_vals;
+		}
+		inflight_min_f = min(inflight_min_f, curr->getFVal());
+		batch.push_back(curr);
+	}
+
+	replanBatch(children, agents, child_paths);
+
+	// insert the children in the order of the batch, so the result does not depend on the threads
+	for (size_t b = 0; b < batch.size(); b++)
+	{
+		auto curr = batch[b];
+		updatePaths(curr);
+		vector<int> fmin_copy(min_f_vals);
+		bool solved[2] = { false, false };
+		bool foundBypass = false;
+		ECBSNode* child[2] = { children[2 * b], children[2 * b + 1] };
+		for (int i = 0; i < 2 && !foundBypass; i++)
+		{
+			solved[i] = finishChild(child[i], child_paths[2 * b + i]);
+			if (!solved[i] || !bypass || curr->chosen_from == SOURCE_CLEANUP || (i == 1 && !solved[0]) ||
+				child[i]->sum_of_costs > suboptimality * cost_lowerbound ||
+				child[i]->distance_to_go >= curr->distance_to_go)
+				continue;
+			foundBypass = true; // Bypass1
+			for (const auto& path : child[i]->paths)
+			{
+				if ((double)path.second.first.size() - 1 > suboptimality * fmin_copy[path.first]) // Our bypassing
+				{
+					foundBypass = false;
+					break;
+				}
+			}
+			if (foundBypass)
+			{
+				updatePaths(curr); // adoptBypass updates the view of curr
+				adoptBypass(curr, child[i], fmin_copy);
+				logNode(*curr, CheckpointLog::PATHS);
+				if (screen > 1)
+					cout << "	Update " << *curr << endl;
+			}
+		}
+		if (foundBypass)
+		{
+			// instead of expanding curr again right away, put it back with the adopted paths
+			for (auto & i : child)
+				discardNode(i);
+			// and count it as expanded only when it is selected again; its time_expanded stays set, as retireNodes
+			// must not drop the adopted paths
+			num_HL_expanded--;
+			insertNode(curr);
+			logEvent(*curr, CheckpointLog::REOPEN);
+			continue;
+		}
+		switch (curr->conflict->type)
+		{
+		case conflict_type::RECTANGLE:
+			num_rectangle_conflicts++;
+			break;
+		case conflict_type::CORRIDOR:
+			num_corridor_conflicts++;
+			break;
+		case  conflict_type::TARGET:
+			num_target_conflicts++;
+			break;
+		case conflict_type::STANDARD:
+			num_standard_conflicts++;
+			break;
+		case conflict_type::MUTEX:
+			num_mutex_conflicts++;
+			break;
+		default:
+			break;
+		}
+		if (curr->chosen_from == SOURCE_CLEANUP)
+			num_cleanup++;
+		else if (curr->chosen_from == SOURCE_OPEN)
+			num_open++;
+		else if (curr->chosen_from == SOURCE_FOCAL)
+			num_focal++;
+		if (curr->conflict->priority == conflict_priority::CARDINAL)
+			num_cardinal_conflicts++;
+		for (int i = 0; i < 2; i++)
+		{
+			if (!solved[i])
+			{
+				discardNode(child[i]);
+				continue;
+			}
+			pushNode(child[i]);
+			curr->children.push_back(child[i]);
+			if (screen > 1)
+				cout << "		Generate " << *child[i] << endl;
+		}
+		if (!curr->children.empty())
+			heuristic_helper.updateOnlineHeuristicErrors(*curr);
+		curr->clear();
+	}
+	return false;
+}
+
+// find the paths of the children on num_of_threads threads
+void ECBS::replanBatch(vector<ECBSNode*>& children, const vector<set<int>>& agents, vector<ChildPaths>& rst)
+{
+	clock_t t1 = clock();
+	// the search engines are per agent, so a child holds the engines of its agents while it is replanned.
+	// The locks are taken in increasing agent order (the order of the sets) to avoid deadlocks.
+	vector<std::mutex> engine_locks(num_of_agents);
+	parallelFor(children.size(), num_of_threads, [&](size_t i)
+	{
+		for (auto agent : agents[i])
+			engine_locks[agent].lock();
+		rst[i].solved = replanAgents(children[i], agents[i], rst[i].paths, rst[i].min_f_vals, 1);
+		for (auto agent : agents[i])
+			engine_locks[agent].unlock();
+	});
+	runtime_generate_child += (double)(clock() - t1) / CLOCKS_PER_SEC;
+}
+
+
+pair<Path, int> ECBS::searchPath(const ECBSNode* node, int ag, const vector<Path*>& child_paths, int lowerbound)
 {
 	clock_t t = clock();
-	auto new_path = search_engines[ag]->findSuboptimalPath(*node, initial_constraints[ag], paths, ag, min_f_vals[ag], suboptimality);
-	num_LL_expanded += search_engines[ag]->num_expanded;
-	num_LL_generated += search_engines[ag]->num_generated;
-	runtime_build_CT += search_engines[ag]->runtime_build_CT;
-	runtime_build_CAT += search_engines[ag]->runtime_build_CAT;
-	runtime_path_finding += (double)(clock() - t) / CLOCKS_PER_SEC;
-	if (new_path.first.empty())
-		return false;
-	assert(!isSamePath(*paths[ag], new_path.first));
+	auto new_path = search_engines[ag]->findSuboptimalPath(*node, initial_constraints[ag], child_paths, ag,
+		lowerbound, suboptimality);
+	{
+		std::lock_guard<std::mutex> lock(stats_mutex);
+		num_LL_expanded += search_engines[ag]->num_expanded;
+		num_LL_generated += search_engines[ag]->num_generated;
+		runtime_build_CT += search_engines[ag]->runtime_build_CT;
+		runtime_build_CAT += search_engines[ag]->runtime_build_CAT;
+		runtime_path_finding += (double)(clock() - t) / CLOCKS_PER_SEC;
+	}
+	return new_path;
+}
+
+void ECBS::addPath(ECBSNode* node, int ag, const pair<Path, int>& new_path, vector<Path*>& child_paths, vector<int>& child_min_f_vals)
+{
+	assert(!isSamePath(*child_paths[ag], new_path.first));
 	node->paths.emplace_back(ag, new_path);
-	node->g_val = node->g_val - min_f_vals[ag] + new_path.second;
-	node->sum_of_costs = node->sum_of_costs - (int) paths[ag]->size() + (int) new_path.first.size();
-	paths[ag] = &node->paths.back().second.first;
-	min_f_vals[ag] = new_path.second;
+	node->g_val = node->g_val - child_min_f_vals[ag] + new_path.second;
+	node->sum_of_costs = node->sum_of_costs - (int) child_paths[ag]->size() + (int) new_path.first.size();
+	child_paths[ag] = &node->paths.back().second.first;
+	child_min_f_vals[ag] = new_path.second;
 	node->makespan = max(node->makespan, new_path.first.size() - 1);
+}
+
+// same as CBS::replanAgents, except that the meta-agents of the agents are replanned jointly
+bool ECBS::replanAgents(ECBSNode* node, const set<int>& agents, vector<Path*>& child_paths, vector<int>& child_min_f_vals, int threads)
+{
+	vector<int> order;
+	set<int> replanned; // the agents of the meta-agents replanned so far
+	for (auto ag : agents)
+	{
+		auto meta_agent = getMetaAgent(node, ag);
+		if (meta_agent.size() == 1)
+		{
+			order.push_back(ag);
+			continue;
+		}
+		if (replanned.count(ag) > 0)
+			continue;
+		replanned.insert(meta_agent.begin(), meta_agent.end());
+		if (!replanMetaAgent(node, meta_agent, child_paths, child_min_f_vals))
+		{
+			if (screen > 1)
+				cout << "	No paths for the meta-agent of agent " << ag << ". Node pruned." << endl;
+			return false;
+		}
+	}
+	vector<pair<Path, int>> new_paths(order.size());
+	if (num_of_threads > 1 && order.size() > 1)
+	{
+		parallelFor(order.size(), threads, [&](size_t i)
+		{
+			new_paths[i] = searchPath(node, order[i], child_paths, child_min_f_vals[order[i]]);
+		});
+	}
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		if (num_of_threads < 2 || order.size() < 2)
+			new_paths[i] = searchPath(node, order[i], child_paths, child_min_f_vals[order[i]]);
+		if (new_paths[i].first.empty())
+		{
+			if (screen > 1)
+				cout << "	No paths for agent " << order[i] << ". Node pruned." << endl;
+			return false;
+		}
+		addPath(node, order[i], new_paths[i], child_paths, child_min_f_vals);
+	}
 	return true;
 }
 
 
+// Meta-agent merging (as in MA-CBS): when the meta-agents of the chosen conflict have conflicted more than
+// merge_threshold times along the branch, curr gets one child where they are merged and planned jointly by a CBS
+// over their agents, instead of two children that split on the conflict again. The later constraints on an agent
+// of a meta-agent make its whole meta-agent be replanned jointly.
+bool ECBS::mergeAgents(ECBSNode* curr)
+{
+	curr->conflict = chooseConflict(*curr); // kept for the split if the meta-agents are not merged
+	const auto& conflict = curr->conflict;
+	if (conflict == nullptr)
+		return false;
+	auto meta_agent1 = getMetaAgent(curr, conflict->a1);
+	auto meta_agent2 = getMetaAgent(curr, conflict->a2);
+	if (countConflicts(curr, meta_agent1, meta_agent2) <= merge_threshold)
+		return false;
+	if (screen > 1)
+		cout << "	Merge the meta-agents of " << conflict->a1 << " and " << conflict->a2 << " in " << *curr << endl;
+	clock_t t1 = clock();
+	auto child = node_arena.create<ECBSNode>();
+	initChild(child, curr);
+	child->merges.emplace_back(conflict->a1, conflict->a2);
+	bool solved = replanAgents(child, set<int>{ conflict->a1, conflict->a2 }, paths, min_f_vals, num_of_threads);
+	if (solved)
+	{
+		findConflicts(*child);
+		heuristic_helper.computeQuickHeuristics(*child);
+	}
+	runtime_generate_child += (double)(clock() - t1) / CLOCKS_PER_SEC;
+	if (!solved) // the merged meta-agent has no solution under the constraints, so neither has curr
+	{
+		discardNode(child);
+		return true;
+	}
+	num_merges++;
+	pushNode(child);
+	curr->children.push_back(child);
+	if (screen > 1)
+		cout << "		Generate " << *child << endl;
+	return true;
+}
+
+vector<int> ECBS::getMetaAgent(const ECBSNode* node, int agent) const
+{
+	vector<int> meta_agent{ agent };
+	if (merge_threshold <= 0)
+		return meta_agent;
+	list< pair<int, int> > merges;
+	for (auto n = node; n != nullptr; n = n->parent)
+		merges.insert(merges.end(), n->merges.begin(), n->merges.end());
+	for (size_t i = 0; i < meta_agent.size(); i++)
+	{
+		for (const auto& merge : merges)
+		{
+			int other = merge.first == meta_agent[i] ? merge.second : merge.second == meta_agent[i] ? merge.first : -1;
+			if (other >= 0 && std::find(meta_agent.begin(), meta_agent.end(), other) == meta_agent.end())
+				meta_agent.push_back(other);
+		}
+	}
+	std::sort(meta_agent.begin(), meta_agent.end());
+	return meta_agent;
+}
+
+// the conflict chosen in node counts as well
+int ECBS::countConflicts(const ECBSNode* node, const vector<int>& meta_agent1, const vector<int>& meta_agent2) const
+{
+	auto contains = [](const vector<int>& meta_agent, int agent)
+	{
+		return std::binary_search(meta_agent.begin(), meta_agent.end(), agent);
+	};
+	int count = 1;
+	for (auto n = node->parent; n != nullptr; n = n->parent)
+	{
+		const auto& conflict = n->conflict;
+		if (conflict != nullptr &&
+			((contains(meta_agent1, conflict->a1) && contains(meta_agent2, conflict->a2)) ||
+			(contains(meta_agent1, conflict->a2) && contains(meta_agent2, conflict->a1))))
+			count++;
+	}
+	return count;
+}
+
+// The sub-problem is solved optimally, like the two-agent problems of the CBS heuristics, so the sum of the new
+// costs is a lower bound on the costs of the agents below node. The unchanged paths keep their lower bounds.
+bool ECBS::replanMetaAgent(ECBSNode* node, const vector<int>& agents, vector<Path*>& child_paths, vector<int>& child_min_f_vals)
+{
+	clock_t t = clock();
+	vector<SingleAgentSolver*> engines;
+	vector<ConstraintTable> constraints;
+	for (auto ag : agents)
+	{
+		engines.push_back(search_engines[ag]);
+		constraints.emplace_back(initial_constraints[ag]);
+		constraints.back().insert2CT(*node, ag);
+	}
+	vector<Path> initial_paths; // planned by the sub-solver
+	CBS cbs(engines, constraints, initial_paths, 0);
+	cbs.setPrioritizeConflicts(PC);
+	cbs.setHeuristicType(heuristics_type::CG, heuristics_type::ZERO);
+	cbs.setDisjointSplitting(disjoint_splitting);
+	cbs.setBypass(false);
+	cbs.setRectangleReasoning(rectangle_reasoning);
+	cbs.setCorridorReasoning(corridor_reasoning);
+	cbs.setTargetReasoning(target_reasoning);
+	cbs.setWindow(window);
+	cbs.setMutexReasoning(mutex_reasoning);
+	cbs.setConflictSelectionRule(conflict_selection_rule);
+	cbs.setNodeSelectionRule(node_selection_rule);
+	cbs.setHighLevelSolver(high_level_solver_type::ASTAR, 1);
+	cbs.setCancelFlag(cancel_flag);
+	cbs.solve(time_limit - getRuntime());
+	{
+		std::lock_guard<std::mutex> lock(stats_mutex);
+		num_LL_expanded += cbs.num_LL_expanded;
+		num_LL_generated += cbs.num_LL_generated;
+		runtime_path_finding += (double)(clock() - t) / CLOCKS_PER_SEC;
+	}
+	if (!cbs.solution_found)
+		return false;
+	for (int i = 0; i < (int)agents.size(); i++)
+	{
+		const auto& path = cbs.getPath(i);
+		// the lengths of the joint paths are not lower bounds, as the heuristic on the lattice can overestimate, so
+		// the agents keep the lower bounds they have, which the constraints of node can only raise
+		if (!isSamePath(*child_paths[agents[i]], path))
+			addPath(node, agents[i], make_pair(path, child_min_f_vals[agents[i]]), child_paths, child_min_f_vals);
+	}
+	return true;
+}
+
 inline void ECBS::pushNode(ECBSNode* node)
 {
 	num_HL_generated++;
 	node->time_generated = num_HL_generated;
+	insertNode(node);
+	allNodes_table.push_back(node);
+	hl_memory += node_arena.getNodeSize() + getPathBytes(*node);
+	logNode(*node, CheckpointLog::NODE);
+	if (best_effort && (best_effort_node == nullptr || node->distance_to_go < best_effort_node->distance_to_go))
+		best_effort_node = node;
+}
+
+
+inline void ECBS::insertNode(ECBSNode* node)
+{
 	// update handles
     node->cleanup_handle = cleanup_list.push(node);
 	switch (solver_type)
@@ -399,7 +1160,6 @@ inline void ECBS::pushNode(ECBSNode* node)
 	default:
 		break;
 	}
-	allNodes_table.push_back(node);
 }
 
 
@@ -435,10 +1195,471 @@ inline bool ECBS::reinsertNode(ECBSNode* node)
 }
 
 
-ECBSNode* ECBS::selectNode()
+// Retire the unexpanded nodes with the largest f (then f-hat) until the memory is below 3/4 of the limit.
+// A retired node keeps its place in the lists with its f, f-hat and d, so the lower bound and the order of
+// the search are unchanged; only its paths and conflicts are dropped, and regenerateNode finds them again
+// from its parent and its constraints if it is selected.
+void ECBS::retireNodes()
+{
+	vector<ECBSNode*> candidates;
+	for (auto node : cleanup_list)
+	{
+		// expanded nodes may have adopted the paths of a bypass, which their constraints do not reproduce
+		if (node->parent != nullptr && node->time_expanded == 0 && !node->isRetired())
+			candidates.push_back(node);
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const ECBSNode* n1, const ECBSNode* n2)
+	{
+		return !ECBSNode::compare_node_by_f()(n2, n1); // worst first
+	});
+	size_t target = hl_memory_limit / 4 * 3;
+	for (auto node : candidates)
+	{
+		if (hl_memory <= target)
+			break;
+		retireNode(node);
+		num_retired++;
+	}
+	if (hl_memory > target) // the rest is held by expanded nodes and node shells, which are not retired
+	{
+		retirement_mark = num_HL_generated + num_regenerated; // so wait for new candidates before scanning again
+		if (!retirement_warned)
+		{
+			cerr << "Warning: the CT nodes cannot be retired down to --hl-memory-mb, as they still hold " <<
+				hl_memory / (1024.0 * 1024) << " MB" << endl;
+			retirement_warned = true;
+		}
+	}
+	if (screen > 1)
+		cout << "	Retire nodes down to " << hl_memory / (1024.0 * 1024) << " MB" << endl;
+}
+
+void ECBS::retireNode(ECBSNode* node)
+{
+	hl_memory -= getPathBytes(*node);
+	for (const auto& path : node->paths) // the index may still point to the paths
+		occupancy.invalidate(path.first);
+	node->paths.clear();
+	node->clear();
+	// it is left with a stub of its constraints and keys; its fingerprints are derived again from its parent
+	node->conflict.reset();
+	node->agent_fingerprints = AgentFingerprints();
+}
+
+// The paths of the parent are in view (see updatePaths), so replanning the agents that violate the constraints
+// of the node finds paths for it again. Its h values are kept, and its conflicts are detected again from scratch,
+// as the parent has dropped its own after its expansion. The new paths may differ from the ones it was generated
+// with, as the suboptimality changes under --anytime and --bestEffort and meta-agents are replanned within the time
+// left: a node whose agents cannot be replanned is pruned, and a node whose costs changed is put back into the
+// lists with its new keys. Returns false in both cases.
+bool ECBS::regenerateNode(ECBSNode* node)
+{
+	clock_t t1 = clock();
+	int g_val = node->g_val;
+	int sum_of_costs = node->sum_of_costs;
+	node->g_val = node->parent->g_val;
+	node->sum_of_costs = node->parent->sum_of_costs;
+	node->makespan = node->parent->makespan;
+	node->updateFingerprints();
+	auto agents = getInvalidAgents(node->constraints);
+	for (const auto& merge : node->merges)
+	{
+		agents.insert(merge.first);
+		agents.insert(merge.second);
+	}
+	bool succ = replanAgents(node, agents, paths, min_f_vals, num_of_threads);
+	num_regenerated++;
+	if (!succ)
+	{
+		if (screen > 1)
+			cout << "	Prune " << *node << endl;
+		logEvent(*node, CheckpointLog::CLOSE);
+		node->paths.clear();
+		node->clear();
+		updatePaths(node); // the paths of the agents that were replanned are gone
+		runtime_generate_child += (double)(clock() - t1) / CLOCKS_PER_SEC;
+		return false;
+	}
+	findAllConflicts(*node);
+	hl_memory += getPathBytes(*node);
+	runtime_generate_child += (double)(clock() - t1) / CLOCKS_PER_SEC;
+	if (screen > 1)
+		cout << "	Regenerate " << *node << endl;
+	if (node->g_val == g_val && node->sum_of_costs == sum_of_costs)
+		return true;
+	node->cost_to_go = max(node->cost_to_go, node->getFVal() - node->sum_of_costs); // ensure that f <= f^
+	insertNode(node);
+	return false;
+}
+
+size_t ECBS::getPathBytes(const ECBSNode& node)
+{
+	size_t bytes = 0;
+	for (const auto& path : node.paths) // the list node, the path and its entries
+		bytes += 2 * sizeof(void*) + sizeof(path) + path.second.first.capacity() * sizeof(PathEntry);
+	return bytes;
+}
+
+// Checkpointing. The log holds the instance (HEADER), the paths of the root (ROOT), and then the CT as it grows:
+// every generated node with its constraints, h values and the deltas of its paths to those of its parent (NODE),
+// the paths adopted from a bypass (PATHS), the h values computed when it is selected (VALUES), and when it leaves
+// the lists (CLOSE) or returns to them (REOPEN). Every checkpoint_interval seconds, the look-up table entries
+// added since the last checkpoint are logged (ENTRY), followed by the stats and bounds (CHECKPOINT), so the cost
+// of a checkpoint is bounded by the work done since the last one. A resumed search rebuilds the CT, and puts the
+// nodes that are not closed back into the lists with the lower bounds and suboptimality of the last checkpoint.
+void ECBS::createCheckpoint()
+{
+	if (!checkpoint.create(checkpoint_file))
+	{
+		cerr << "Cannot write the checkpoint " << checkpoint_file << endl;
+		return;
+	}
+	auto signature = getInstanceSignature();
+	checkpoint.put((uint32_t)signature.size());
+	for (auto val : signature)
+		checkpoint.put((int32_t)val);
+	checkpoint.write(CheckpointLog::HEADER);
+	heuristic_helper.log_new_entries = true;
+}
+
+vector<int> ECBS::getInstanceSignature() const
+{
+	vector<int> signature{ num_of_agents, search_engines[0]->instance.map_size, (int)solver_type, window };
+	// the options that shape the CT nodes and the look-up table entries
+	signature.insert(signature.end(), { (int)(suboptimality * 1000000 + 0.5), search_engines[0]->getName() == "SIPP",
+		(int)heuristic_helper.type, (int)heuristic_helper.getInadmissibleHeuristics(), bypass, disjoint_splitting, PC,
+		rectangle_reasoning, corridor_reasoning, target_reasoning, mutex_reasoning, (int)conflict_selection_rule,
+		(int)node_selection_rule });
+	for (const auto& engine : search_engines)
+	{
+		signature.push_back(engine->start_location);
+		signature.push_back(engine->goal_location);
+	}
+	return signature;
+}
+
+const Path& ECBS::getParentPath(const ECBSNode& node, int agent) const
+{
+	for (auto curr = node.parent; curr != nullptr; curr = curr->parent)
+	{
+		for (const auto& path : curr->paths)
+		{
+			if (path.first == agent)
+				return path.second.first;
+		}
+	}
+	return paths_found_initially[agent].first;
+}
+
+void ECBS::logNode(const ECBSNode& node, CheckpointLog::record_type type)
+{
+	if (!checkpoint.isOpen())
+		return;
+	checkpoint.put(node.time_generated);
+	checkpoint.put(node.parent == nullptr ? (uint64_t)0 : node.parent->time_generated);
+	checkpoint.put(node.time_expanded);
+	checkpoint.putConstraints(node.constraints);
+	checkpoint.put((int32_t)node.g_val);
+	checkpoint.put((int32_t)node.h_val);
+	checkpoint.put((int32_t)node.cost_to_go);
+	checkpoint.put((int32_t)node.distance_to_go);
+	checkpoint.put((int32_t)node.sum_of_costs);
+	checkpoint.put((uint32_t)node.depth);
+	checkpoint.put((uint32_t)node.makespan);
+	checkpoint.put((uint8_t)node.h_computed);
+	checkpoint.put((uint32_t)node.paths.size());
+	for (const auto& path : node.paths)
+	{
+		checkpoint.put((int32_t)path.first);
+		checkpoint.put((int32_t)path.second.second);
+		checkpoint.putPath(path.second.first, getParentPath(node, path.first));
+	}
+	checkpoint.write(type);
+}
+
+void ECBS::logValues(const ECBSNode& node)
+{
+	if (!checkpoint.isOpen())
+		return;
+	checkpoint.put(node.time_generated);
+	checkpoint.put((int32_t)node.g_val);
+	checkpoint.put((int32_t)node.h_val);
+	checkpoint.put((int32_t)node.cost_to_go);
+	checkpoint.put((int32_t)node.distance_to_go);
+	checkpoint.put((uint8_t)node.h_computed);
+	checkpoint.write(CheckpointLog::VALUES);
+}
+
+void ECBS::logEvent(const ECBSNode& node, CheckpointLog::record_type type)
+{
+	if (!checkpoint.isOpen())
+		return;
+	checkpoint.put(node.time_generated);
+	checkpoint.put(node.time_expanded);
+	checkpoint.write(type);
+}
+
+template<typename Visitor> void ECBS::visitCheckpointStats(Visitor visit)
+{
+	visit(runtime_generate_child);
+	visit(runtime_build_CT);
+	visit(runtime_build_CAT);
+	visit(runtime_path_finding);
+	visit(runtime_detect_conflicts);
+	visit(runtime_preprocessing);
+	visit(runtime_generate_root);
+	visit(num_cardinal_conflicts);
+	visit(num_corridor_conflicts);
+	visit(num_rectangle_conflicts);
+	visit(num_target_conflicts);
+	visit(num_mutex_conflicts);
+	visit(num_standard_conflicts);
+	visit(num_adopt_bypass);
+	visit(num_root_conflicts);
+	visit(num_root_waves);
+	visit(num_retired);
+	visit(num_regenerated);
+	visit(num_HL_expanded);
+	visit(num_HL_generated);
+	visit(num_LL_expanded);
+	visit(num_LL_generated);
+	visit(num_cleanup);
+	visit(num_open);
+	visit(num_focal);
+	visit(heuristic_helper.runtime_build_dependency_graph);
+	visit(heuristic_helper.runtime_solve_MVC);
+	visit(heuristic_helper.num_solve_MVC);
+	visit(heuristic_helper.num_merge_MDDs);
+	visit(heuristic_helper.num_solve_2agent_problems);
+	visit(heuristic_helper.num_memoization);
+	visit(cost_lowerbound);
+	visit(inadmissible_cost_lowerbound);
+	visit(suboptimality);
+}
+
+void ECBS::writeCheckpoint()
+{
+	clock_t t = clock();
+	for (auto entry : heuristic_helper.takeNewEntries())
+	{
+		const auto& key = entry->first;
+		checkpoint.put((int32_t)key.a1);
+		checkpoint.put((int32_t)key.a2);
+		checkpoint.put(key.fp1.lo);
+		checkpoint.put(key.fp1.hi);
+		checkpoint.put(key.fp2.lo);
+		checkpoint.put(key.fp2.hi);
+		checkpoint.put(key.n == nullptr ? (uint64_t)0 : key.n->time_generated);
+		checkpoint.put((int32_t)get<0>(entry->second));
+		checkpoint.put((int32_t)get<1>(entry->second));
+		checkpoint.put((int32_t)get<2>(entry->second));
+		checkpoint.write(CheckpointLog::ENTRY);
+	}
+	last_checkpoint = getRuntime();
+	checkpoint.put(last_checkpoint);
+	visitCheckpointStats([&](auto& val) { checkpoint.put(val); });
+	vector<double> distance_errors, cost_errors;
+	vector<int> counts;
+	heuristic_helper.getOnlineErrors(distance_errors, cost_errors, counts);
+	checkpoint.put((uint32_t)counts.size());
+	for (size_t i = 0; i < counts.size(); i++)
+	{
+		checkpoint.put(distance_errors[i]);
+		checkpoint.put(cost_errors[i]);
+		checkpoint.put((int32_t)counts[i]);
+	}
+	checkpoint.write(CheckpointLog::CHECKPOINT);
+	if (screen > 1)
+		cout << "Checkpoint " << checkpoint.getBytesWritten() / (1024.0 * 1024) << " MB in " <<
+			(double)(clock() - t) / CLOCKS_PER_SEC << " s" << endl;
+}
+
+bool ECBS::loadCheckpoint()
+{
+	if (!checkpoint.open(checkpoint_file))
+	{
+		checkpoint.close();
+		if (screen > 0)
+			cout << "No checkpoint in " << checkpoint_file << ", so the search starts from the root" << endl;
+		return false;
+	}
+	initTables();
+	vector<ECBSNode*> nodes(1, nullptr); // by id (time_generated), 0 for none
+	vector<bool> closed(1, false);
+	double elapsed = 0;
+	while (checkpoint.next())
+	{
+		switch (checkpoint.getType())
+		{
+		case CheckpointLog::HEADER:
+		{
+			vector<int> signature(checkpoint.get<uint32_t>());
+			for (auto& val : signature)
+				val = checkpoint.get<int32_t>();
+			if (signature != getInstanceSignature())
+			{
+				cerr << "The checkpoint " << checkpoint_file << " is of another instance or solver" << endl;
+				exit(-1);
+			}
+			break;
+		}
+		case CheckpointLog::ROOT:
+			for (auto& path : paths_found_initially)
+			{
+				path.second = checkpoint.get<int32_t>();
+				checkpoint.getPath(path.first, Path());
+			}
+			break;
+		case CheckpointLog::NODE:
+		case CheckpointLog::PATHS:
+		{
+			auto node = readNode(nodes);
+			closed.resize(nodes.size(), false);
+			if (node->parent == nullptr)
+				dummy_start = node;
+			break;
+		}
+		case CheckpointLog::VALUES:
+		{
+			auto node = nodes[checkpoint.get<uint64_t>()];
+			node->g_val = checkpoint.get<int32_t>();
+			node->h_val = checkpoint.get<int32_t>();
+			node->cost_to_go = checkpoint.get<int32_t>();
+			node->distance_to_go = checkpoint.get<int32_t>();
+			node->h_computed = checkpoint.get<uint8_t>() != 0;
+			break;
+		}
+		case CheckpointLog::CLOSE:
+		case CheckpointLog::REOPEN:
+		{
+			auto id = checkpoint.get<uint64_t>();
+			nodes[id]->time_expanded = checkpoint.get<uint64_t>();
+			closed[id] = checkpoint.getType() == CheckpointLog::CLOSE;
+			break;
+		}
+		case CheckpointLog::ENTRY:
+		{
+			HTableEntry key;
+			key.a1 = checkpoint.get<int32_t>();
+			key.a2 = checkpoint.get<int32_t>();
+			key.fp1.lo = checkpoint.get<uint64_t>();
+			key.fp1.hi = checkpoint.get<uint64_t>();
+			key.fp2.lo = checkpoint.get<uint64_t>();
+			key.fp2.hi = checkpoint.get<uint64_t>();
+			auto id = checkpoint.get<uint64_t>();
+			key.n = id < nodes.size() ? nodes[id] : nullptr;
+			int h = checkpoint.get<int32_t>();
+			int v1 = checkpoint.get<int32_t>();
+			int v2 = checkpoint.get<int32_t>();
+			if (key.n != nullptr) // the node is only needed to check the fingerprints
+				heuristic_helper.restoreEntry(key, make_tuple(h, v1, v2));
+			break;
+		}
+		case CheckpointLog::CHECKPOINT:
+		{
+			elapsed = checkpoint.get<double>();
+			visitCheckpointStats([&](auto& val) { val = checkpoint.get<typename std::decay<decltype(val)>::type>(); });
+			vector<double> distance_errors(checkpoint.get<uint32_t>()), cost_errors(distance_errors.size());
+			vector<int> counts(distance_errors.size());
+			for (size_t i = 0; i < counts.size(); i++)
+			{
+				distance_errors[i] = checkpoint.get<double>();
+				cost_errors[i] = checkpoint.get<double>();
+				counts[i] = checkpoint.get<int32_t>();
+			}
+			heuristic_helper.setOnlineErrors(distance_errors, cost_errors, counts);
+			break;
+		}
+		}
+	}
+	checkpoint.close();
+
+	size_t num_open_nodes = 0;
+	for (size_t id = 1; id < nodes.size(); id++)
+	{
+		auto node = nodes[id];
+		if (best_effort && (best_effort_node == nullptr || node->distance_to_go < best_effort_node->distance_to_go))
+			best_effort_node = node;
+		if (closed[id])
+			continue;
+		node->restored = true;
+		insertNode(node);
+		num_open_nodes++;
+	}
+	updatePaths(static_cast<ECBSNode*>(dummy_start));
+	start -= std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(elapsed));
+	last_checkpoint = elapsed;
+	if (!checkpoint.append(checkpoint_file, checkpoint.getLength()))
+		cerr << "Cannot write the checkpoint " << checkpoint_file << endl;
+	else
+		heuristic_helper.log_new_entries = true;
+	if (screen > 0)
+		cout << "Resume from " << checkpoint_file << " after " << elapsed << " s with " << nodes.size() - 1 <<
+			" CT nodes (" << num_open_nodes << " open)" << endl;
+	return true;
+}
+
+ECBSNode* ECBS::readNode(vector<ECBSNode*>& nodes)
+{
+	auto id = checkpoint.get<uint64_t>();
+	auto parent = nodes[checkpoint.get<uint64_t>()];
+	auto time_expanded = checkpoint.get<uint64_t>();
+	ECBSNode* node;
+	if (checkpoint.getType() == CheckpointLog::NODE)
+	{
+		node = node_arena.create<ECBSNode>();
+		assert(id == nodes.size());
+		nodes.push_back(node);
+		node->time_generated = id;
+		node->parent = parent;
+		node->HLNode::parent = parent;
+		if (parent != nullptr)
+			parent->children.push_back(node);
+		allNodes_table.push_back(node);
+		hl_memory += node_arena.getNodeSize();
+		checkpoint.getConstraints(node->constraints);
+		node->updateFingerprints();
+	}
+	else // the paths of a bypass replace those of the node
+	{
+		node = nodes[id];
+		hl_memory -= getPathBytes(*node);
+		node->paths.clear();
+		ConstraintList constraints;
+		checkpoint.getConstraints(constraints);
+	}
+	node->time_expanded = time_expanded;
+	node->g_val = checkpoint.get<int32_t>();
+	node->h_val = checkpoint.get<int32_t>();
+	node->cost_to_go = checkpoint.get<int32_t>();
+	node->distance_to_go = checkpoint.get<int32_t>();
+	node->sum_of_costs = checkpoint.get<int32_t>();
+	node->depth = checkpoint.get<uint32_t>();
+	node->makespan = checkpoint.get<uint32_t>();
+	node->h_computed = checkpoint.get<uint8_t>() != 0;
+	int num_paths = checkpoint.get<uint32_t>();
+	for (int i = 0; i < num_paths; i++)
+	{
+		int agent = checkpoint.get<int32_t>();
+		int min_f = checkpoint.get<int32_t>();
+		node->paths.emplace_back(agent, make_pair(Path(), min_f));
+		checkpoint.getPath(node->paths.back().second.first, getParentPath(*node, agent));
+	}
+	hl_memory += getPathBytes(*node);
+	return node;
+}
+
+ECBSNode* ECBS::selectNode(int inflight_min_f)
 {
 	ECBSNode* curr = nullptr;
 	assert(solver_type != high_level_solver_type::ASTAR);
+	if (hl_memory_limit > 0 && hl_memory > hl_memory_limit && num_HL_generated + num_regenerated > retirement_mark)
+		retireNodes();
+	if (best_effort)
+		adaptSuboptimality();
+	// the nodes selected but not expanded yet are still part of the frontier, so they bound the lower bound too,
+	// and so do the goal nodes found by the anytime search
+	int min_f_val = min(min(cleanup_list.top()->getFVal(), inflight_min_f), solved_min_f);
 	switch (solver_type)
 	{
 	case high_level_solver_type::EES:
@@ -456,13 +1677,14 @@ ECBSNode* ECBS::selectNode()
 		}
 
 		// choose the best node
-		if (screen > 1 && cleanup_list.top()->getFVal() > cost_lowerbound)
-			cout << "Lowerbound increases from " << cost_lowerbound << " to " << cleanup_list.top()->getFVal() << endl;
-		cost_lowerbound = max(cleanup_list.top()->getFVal(), cost_lowerbound);
+		if (screen > 1 && min_f_val > cost_lowerbound)
+			cout << "Lowerbound increases from " << cost_lowerbound << " to " << min_f_val << endl;
+		cost_lowerbound = max(min_f_val, cost_lowerbound);
+		tightenSuboptimality();
 		if (focal_list.top()->sum_of_costs <= suboptimality * cost_lowerbound)
 		{ // return best d
 			curr = focal_list.top();
-			curr->chosen_from = "focal";
+			curr->chosen_from = SOURCE_FOCAL;
 			/*curr->f_of_best_in_cleanup = cleanup_list.top()->getFVal();
 			curr->f_hat_of_best_in_cleanup = cleanup_list.top()->getFHatVal();
 			curr->d_of_best_in_cleanup = cleanup_list.top()->distance_to_go;
@@ -479,7 +1701,7 @@ ECBSNode* ECBS::selectNode()
 		else if (open_list.top()->sum_of_costs <= suboptimality * cost_lowerbound)
 		{ // return best f_hat
 			curr = open_list.top();
-			curr->chosen_from = "open";
+			curr->chosen_from = SOURCE_OPEN;
 			/*curr->f_of_best_in_cleanup = cleanup_list.top()->getFVal();
 			curr->f_hat_of_best_in_cleanup = cleanup_list.top()->getFHatVal();
 			curr->d_of_best_in_cleanup = cleanup_list.top()->distance_to_go;
@@ -496,7 +1718,7 @@ ECBSNode* ECBS::selectNode()
 		else
 		{ // return best f
 			curr = cleanup_list.top();
-			curr->chosen_from = "cleanup";
+			curr->chosen_from = SOURCE_CLEANUP;
 			/*curr->f_of_best_in_cleanup = cleanup_list.top()->getFVal();
 			curr->f_hat_of_best_in_cleanup = cleanup_list.top()->getFHatVal();
 			curr->d_of_best_in_cleanup = cleanup_list.top()->distance_to_go;
@@ -514,14 +1736,15 @@ ECBSNode* ECBS::selectNode()
 		break;
 	case high_level_solver_type::ASTAREPS:
 		// update the focal list if necessary
-		if (cleanup_list.top()->getFVal() > cost_lowerbound)
+		if (min_f_val > cost_lowerbound)
 		{
 			if (screen == 3)
 			{
 				cout << "  Note -- FOCAL UPDATE!! from |FOCAL|=" << focal_list.size() << " with |OPEN|=" << cleanup_list.size() << " to |FOCAL|=";
 			}
 			double old_focal_list_threshold = suboptimality * cost_lowerbound;
-			cost_lowerbound = max(cost_lowerbound, cleanup_list.top()->getFVal());
+			cost_lowerbound = max(cost_lowerbound, min_f_val);
+			tightenSuboptimality();
 			double new_focal_list_threshold = suboptimality * cost_lowerbound;
 			for (auto n : cleanup_list)
 			{
@@ -534,9 +1757,16 @@ ECBSNode* ECBS::selectNode()
 			}
 		}
 
+		if (focal_list.empty()) // the anytime search lowered the suboptimality below that of the paths
+		{
+			curr = cleanup_list.top();
+			curr->chosen_from = SOURCE_CLEANUP;
+			cleanup_list.pop();
+			break;
+		}
 		// choose best d in the focal list
 		curr = focal_list.top();
-		curr->chosen_from = "focal";
+		curr->chosen_from = SOURCE_FOCAL;
 		/*curr->f_of_best_in_cleanup = cleanup_list.top()->getFVal();
 		curr->f_hat_of_best_in_cleanup = cleanup_list.top()->getFHatVal();
 		curr->d_of_best_in_cleanup = cleanup_list.top()->distance_to_go;
@@ -548,14 +1778,15 @@ ECBSNode* ECBS::selectNode()
 		break;
 	case high_level_solver_type::NEW:
 		// update the focal list if necessary
-		if (cleanup_list.top()->getFVal() > cost_lowerbound)
+		if (min_f_val > cost_lowerbound)
 		{
 			if (screen == 3)
 			{
 				cout << "  Note -- FOCAL UPDATE!! from |FOCAL|=" << focal_list.size() << " with |OPEN|=" << cleanup_list.size() << " to |FOCAL|=";
 			}
 			double old_focal_list_threshold = suboptimality * cost_lowerbound;
-			cost_lowerbound = max(cost_lowerbound, cleanup_list.top()->getFVal());
+			cost_lowerbound = max(cost_lowerbound, min_f_val);
+			tightenSuboptimality();
 			double new_focal_list_threshold = suboptimality * cost_lowerbound;
 			focal_list.clear();
 			for (auto n : cleanup_list)
@@ -573,7 +1804,7 @@ ECBSNode* ECBS::selectNode()
 		if (focal_list.empty()) // choose best f in the cleanup list (to improve the lower bound)
 		{
 			curr = cleanup_list.top();
-			curr->chosen_from = "cleanup";
+			curr->chosen_from = SOURCE_CLEANUP;
 			/*curr->f_of_best_in_cleanup = cleanup_list.top()->getFVal();
 			curr->f_hat_of_best_in_cleanup = cleanup_list.top()->getFHatVal();
 			curr->d_of_best_in_cleanup = cleanup_list.top()->distance_to_go;*/
@@ -582,7 +1813,7 @@ ECBSNode* ECBS::selectNode()
 		else // choose best d in the focal list
 		{
 			curr = focal_list.top();
-			curr->chosen_from = "focal";
+			curr->chosen_from = SOURCE_FOCAL;
 			/*curr->f_of_best_in_cleanup = cleanup_list.top()->getFVal();
 			curr->f_hat_of_best_in_cleanup = cleanup_list.top()->getFHatVal();
 			curr->d_of_best_in_cleanup = cleanup_list.top()->distance_to_go;
@@ -599,6 +1830,14 @@ ECBSNode* ECBS::selectNode()
 
 	// takes the paths_found_initially and UPDATE all constrained paths found for agents from curr to dummy_start (and lower-bounds)
 	updatePaths(curr);
+	if (curr->isRetired())
+	{
+		if (!regenerateNode(curr))
+			return nullptr; // pruned, or back in the lists with the keys of its new paths
+	}
+	else if (curr->restored)
+		findAllConflicts(*curr);
+	curr->restored = false;
 
 	if (screen > 1)
 		cout << endl << "Pop " << *curr << endl;
@@ -633,7 +1872,7 @@ void ECBS::classifyConflicts(ECBSNode &node)
 		node.unknownConf.pop_front();
 
 		if (PC)
-		    if (node.chosen_from == "cleanup" ||
+		    if (node.chosen_from == SOURCE_CLEANUP ||
                // (min_f_vals[a1] * suboptimality >= min_f_vals[a1] + 1 &&
                //min_f_vals[a2] * suboptimality >= min_f_vals[a2] + 1))
                (int)paths[a1]->size() - 1 == min_f_vals[a1] ||
@@ -696,7 +1935,8 @@ void ECBS::classifyConflicts(ECBSNode &node)
 		{
 			auto mdd1 = mdd_helper.getMDD(node, a1, paths[a1]->size());
 			auto mdd2 = mdd_helper.getMDD(node, a2, paths[a2]->size());
-			auto rectangle = rectangle_helper.run(paths, timestep, a1, a2, mdd1, mdd2);
+			auto rectangle = mdd1->levels.empty() || mdd2->levels.empty() ? nullptr : // MDD not built
+				rectangle_helper.run(paths, timestep, a1, a2, mdd1, mdd2);
 			if (rectangle != nullptr)
 			{
                 if (!PC)
@@ -740,30 +1980,24 @@ void ECBS::computeConflictPriority(shared_ptr<Conflict>& con, ECBSNode& node)
 	{
 		if (timestep < (int)mdd1->levels.size())
 		{
-			cardinal1 = mdd1->levels[timestep].size() == 1 &&
-				mdd1->levels[timestep].front()->location == paths[a1]->at(timestep).location &&
-				mdd1->levels[timestep - 1].size() == 1 &&
-				mdd1->levels[timestep - 1].front()->location == paths[a1]->at(timestep - 1).location;
+			cardinal1 = mdd1->isSingleton(timestep, paths[a1]->at(timestep).location) &&
+				mdd1->isSingleton(timestep - 1, paths[a1]->at(timestep - 1).location);
 		}
 		if (timestep < (int)mdd2->levels.size())
 		{
-			cardinal2 = mdd2->levels[timestep].size() == 1 &&
-				mdd2->levels[timestep].front()->location == paths[a2]->at(timestep).location &&
-				mdd2->levels[timestep - 1].size() == 1 &&
-				mdd2->levels[timestep - 1].front()->location == paths[a2]->at(timestep - 1).location;
+			cardinal2 = mdd2->isSingleton(timestep, paths[a2]->at(timestep).location) &&
+				mdd2->isSingleton(timestep - 1, paths[a2]->at(timestep - 1).location);
 		}
 	}
 	else // vertex conflict or target conflict
 	{
 		if (!cardinal1 && timestep < (int)mdd1->levels.size())
 		{
-			cardinal1 = mdd1->levels[timestep].size() == 1 &&
-				mdd1->levels[timestep].front()->location == paths[a1]->at(timestep).location;
+			cardinal1 = mdd1->isSingleton(timestep, paths[a1]->at(timestep).location);
 		}
 		if (!cardinal2 && timestep < (int)mdd2->levels.size())
 		{
-			cardinal2 = mdd2->levels[timestep].size() == 1 &&
-				mdd2->levels[timestep].front()->location == paths[a2]->at(timestep).location;
+			cardinal2 = mdd2->isSingleton(timestep, paths[a2]->at(timestep).location);
 		}
 	}
 
@@ -794,9 +2028,20 @@ void ECBS::clear()
     open_list.clear();
     cleanup_list.clear();
     focal_list.clear();
-    for (auto& node : allNodes_table)
-        delete node;
-    allNodes_table.clear();
+    node_arena.release(allNodes_table);
+    hl_memory = 0;
+    retirement_mark = 0;
+    retirement_warned = false;
+    incumbent = nullptr;
+    solved_min_f = MAX_COST;
+    best_effort_node = nullptr;
+    last_adaptation = 0;
+    best_effort_plan = false;
+    remaining_conflicts.clear();
+    num_remaining_conflicts = 0;
+    checkpoint.close();
+    last_checkpoint = 0;
+    cost_upperbound = MAX_COST;
 
     dummy_start = nullptr;
     goal_node = nullptr;
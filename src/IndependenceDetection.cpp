@@ -0,0 +1,229 @@
+#include "IndependenceDetection.h"
+#include <numeric>
+
+
+IndependenceDetection::IndependenceDetection(const Instance& instance, bool sipp, int screen, int num_of_threads,
+	const std::function<void(ECBS&)>& set_up_solver) :
+	instance(instance), sipp(sipp), screen(screen), num_of_threads(max(1, num_of_threads)),
+	set_up_solver(set_up_solver), heuristic_source(instance, sipp, 0),
+	num_of_agents(instance.getDefaultNumberOfAgents()), paths(num_of_agents) {}
+
+bool IndependenceDetection::solve(double time_limit)
+{
+	auto start = std::chrono::steady_clock::now();
+	groups.clear();
+	for (int i = 0; i < num_of_agents; i++)
+		groups.emplace_back(1, i);
+	vector<int> unsolved(groups.size());
+	std::iota(unsolved.begin(), unsolved.end(), 0);
+	while (true)
+	{
+		num_rounds++;
+		double remaining = time_limit - std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (remaining <= 0)
+			break;
+		// a single group gets all threads for its own search
+		int threads = unsolved.size() > 1 ? 1 : num_of_threads;
+		vector<GroupStats> stats(unsolved.size());
+		vector<char> solved(unsolved.size(), false);
+		CBS::parallelFor(unsolved.size(), num_of_threads, [&](size_t i)
+		{
+			solved[i] = solveGroup(groups[unsolved[i]], remaining, threads, stats[i]);
+		});
+		num_group_solves += unsolved.size();
+		for (const auto& s : stats)
+		{
+			num_HL_expanded += s.num_HL_expanded;
+			num_HL_generated += s.num_HL_generated;
+			num_LL_expanded += s.num_LL_expanded;
+			num_LL_generated += s.num_LL_generated;
+		}
+		if (std::find(solved.begin(), solved.end(), false) != solved.end())
+			break;
+		if (screen > 1)
+			cout << "Independence detection round " << num_rounds << ": " << unsolved.size() << " groups solved, " <<
+				groups.size() << " groups of sizes " << getGroupSizes() << endl;
+		if (!mergeConflictingGroups(unsolved)) // validated across the groups
+		{
+			solution_found = true;
+			solution_cost = 0;
+			for (const auto& path : paths)
+				solution_cost += (int)path.size() - 1;
+			break;
+		}
+	}
+	runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (screen > 0)
+		printResults();
+	return solution_found;
+}
+
+bool IndependenceDetection::solveGroup(const vector<int>& group, double time_limit, int threads, GroupStats& stats)
+{
+	Instance group_instance(instance, group);
+	ECBS ecbs(group_instance, sipp, 0, &heuristic_source, group);
+	set_up_solver(ecbs);
+	ecbs.setNumOfThreads(threads);
+	ecbs.solve(time_limit);
+	if (ecbs.solution_found)
+	{
+		for (int i = 0; i < (int)group.size(); i++)
+			paths[group[i]] = ecbs.getPath(i);
+	}
+	stats.num_HL_expanded = ecbs.num_HL_expanded;
+	stats.num_HL_generated = ecbs.num_HL_generated;
+	stats.num_LL_expanded = ecbs.num_LL_expanded;
+	stats.num_LL_generated = ecbs.num_LL_generated;
+	ecbs.clearSearchEngines();
+	return ecbs.solution_found;
+}
+
+// Merge every set of groups connected by conflicts into one group, and return the new groups in merged.
+bool IndependenceDetection::mergeConflictingGroups(vector<int>& merged)
+{
+	vector<int> group_of(num_of_agents);
+	for (int g = 0; g < (int)groups.size(); g++)
+	{
+		for (auto agent : groups[g])
+			group_of[agent] = g;
+	}
+	vector<int> parent(groups.size());
+	std::iota(parent.begin(), parent.end(), 0);
+	std::function<int(int)> find = [&](int g) { return parent[g] == g ? g : parent[g] = find(parent[g]); };
+
+	OccupancyIndex occupancy;
+	occupancy.reset(instance.map_size, instance.num_of_cols);
+	vector<Path*> indexed(num_of_agents);
+	for (int i = 0; i < num_of_agents; i++)
+		indexed[i] = &paths[i];
+	occupancy.sync(indexed);
+	vector<int> candidates;
+	bool found = false;
+	for (int a1 = 0; a1 < num_of_agents; a1++)
+	{
+		occupancy.getCandidates(paths[a1], candidates);
+		for (auto a2 : candidates)
+		{
+			if (a2 <= a1 || find(group_of[a1]) == find(group_of[a2]) ||
+				!conflicting(paths[a1], paths[a2], instance.num_of_cols))
+				continue;
+			parent[find(group_of[a1])] = find(group_of[a2]);
+			found = true;
+		}
+	}
+	if (!found)
+		return false;
+
+	vector< vector<int> > new_groups;
+	vector<int> new_group_of(groups.size(), -1);
+	vector<int> sources; // number of old groups in each new group
+	for (int g = 0; g < (int)groups.size(); g++)
+	{
+		int root = find(g);
+		if (new_group_of[root] < 0)
+		{
+			new_group_of[root] = (int)new_groups.size();
+			new_groups.emplace_back();
+			sources.push_back(0);
+		}
+		auto& group = new_groups[new_group_of[root]];
+		group.insert(group.end(), groups[g].begin(), groups[g].end());
+		sources[new_group_of[root]]++;
+	}
+	merged.clear();
+	for (int g = 0; g < (int)new_groups.size(); g++)
+	{
+		if (sources[g] == 1)
+			continue;
+		std::sort(new_groups[g].begin(), new_groups[g].end());
+		merged.push_back(g);
+	}
+	num_merges += groups.size() - new_groups.size();
+	groups.swap(new_groups);
+	return true;
+}
+
+bool IndependenceDetection::conflicting(const Path& path1, const Path& path2, int num_of_cols)
+{
+	size_t min_path_length = min(path1.size(), path2.size());
+	for (size_t t = 0; t < min_path_length; t++)
+	{
+		if (path1[t].location == path2[t].location)
+			return true;
+		if (t + 1 < min_path_length &&
+			(MoveInterference::interfere(path1[t], path1[t + 1], path2[t], path2[t + 1], num_of_cols) ||
+			(path1[t].location == path2[t + 1].location && path2[t].location == path1[t + 1].location)))
+			return true;
+	}
+	const auto& shorter = path1.size() < path2.size() ? path1 : path2;
+	const auto& longer = path1.size() < path2.size() ? path2 : path1;
+	for (size_t t = min_path_length; t < longer.size(); t++)
+	{
+		if (longer[t].location == shorter.back().location) // at the goal of the other agent
+			return true;
+	}
+	return false;
+}
+
+int IndependenceDetection::getMaxGroupSize() const
+{
+	size_t size = 0;
+	for (const auto& group : groups)
+		size = max(size, group.size());
+	return (int)size;
+}
+
+string IndependenceDetection::getGroupSizes() const
+{
+	map<size_t, int> counts;
+	for (const auto& group : groups)
+		counts[group.size()]++;
+	string sizes;
+	for (const auto& count : counts)
+		sizes += (sizes.empty() ? "" : " ") + std::to_string(count.first) + "x" + std::to_string(count.second);
+	return sizes;
+}
+
+void IndependenceDetection::printResults() const
+{
+	cout << "Independence detection: " << (solution_found ? "Succeed" : "Fail") << ", cost " << solution_cost <<
+		", runtime " << runtime << " s, " << groups.size() << " groups (largest " << getMaxGroupSize() <<
+		" agents; size x count: " << getGroupSizes() << "), " << num_rounds << " rounds, " << num_merges <<
+		" merges, " << num_group_solves << " group solves, " << num_HL_expanded << " HL expanded" << endl;
+}
+
+void IndependenceDetection::saveResults(const string& fileName, const string& instanceName) const
+{
+	std::ifstream infile(fileName);
+	bool exist = infile.good();
+	infile.close();
+	if (!exist)
+	{
+		ofstream addHeads(fileName);
+		addHeads << "runtime,solution cost,#groups,max group size,mean group size,group sizes," <<
+			"#rounds,#merges,#group solves," <<
+			"#high-level expanded,#high-level generated,#low-level expanded,#low-level generated,instance name" << endl;
+		addHeads.close();
+	}
+	ofstream stats(fileName, std::ios::app);
+	stats << runtime << "," << solution_cost << "," << groups.size() << "," << getMaxGroupSize() << "," <<
+		(groups.empty() ? 0 : (double)num_of_agents / groups.size()) << "," << getGroupSizes() << "," <<
+		num_rounds << "," << num_merges << "," << num_group_solves << "," <<
+		num_HL_expanded << "," << num_HL_generated << "," << num_LL_expanded << "," << num_LL_generated << "," <<
+		instanceName << endl;
+	stats.close();
+}
+
+void IndependenceDetection::savePaths(const string& fileName) const
+{
+	std::ofstream output(fileName, std::ios::out);
+	for (int i = 0; i < num_of_agents; i++)
+	{
+		output << "Agent " << i << ": ";
+		for (const auto& t : paths[i])
+			output << "(" << instance.getRowCoordinate(t.location) << "," << instance.getColCoordinate(t.location) <<
+				"," << t.theta << ")->";
+		output << endl;
+	}
+	output.close();
+}
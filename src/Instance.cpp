@@ -46,6 +46,18 @@ Instance::Instance(const string& map_fname, const string& agent_fname,
 
 }
 
+Instance::Instance(const Instance& instance, const vector<int>& agents) : Instance(instance)
+{
+	num_of_agents = (int)agents.size();
+	start_locations.clear();
+	goal_locations.clear();
+	for (auto agent : agents)
+	{
+		start_locations.push_back(instance.start_locations[agent]);
+		goal_locations.push_back(instance.goal_locations[agent]);
+	}
+}
+
 
 // int Instance::randomWalk(int curr, int steps) const
 // {
@@ -728,28 +740,14 @@ list<pair<int, double> > Instance::getBezierPathCells(int loc1, double ang1, int
 {
 	float x0 = (float) getRowCoordinate(loc1);
 	float y0 = (float) getColCoordinate(loc1);
-	float x3 = (float) getRowCoordinate(loc2);
-	float y3 = (float) getColCoordinate(loc2);
-
-	// first control point
-	float cx1 = x0 - sin(DEG2RAD(ang1));
-	float cy1 = y0 + cos(DEG2RAD(ang1));
-	// second control point - 180 is added since 2nd control point is behind the end point
-	float cx2 = x3 - sin(DEG2RAD(WRAPTO360(ang2 + 180.0f)));
-	float cy2 = y3 + cos(DEG2RAD(WRAPTO360(ang2 + 180.0f)));
-
-	auto cubicBezier = [] (float x0, float x1, float x2, float x3, float ratio) {
-		return pow((1 - ratio), 3)*x0 + 3*pow((1 - ratio), 2)*ratio*x1 + 3*(1 - ratio)*pow(ratio, 2)*x2 + pow(ratio, 3)*x3;
-	};
 
 	vector<pair<float, float> > bezier_path;
 
 	float x, y;
 	for(float ratio = 0; ratio <= 1.001; ratio += 0.05)
 	{
-		x = cubicBezier(x0, cx1, cx2, x3, ratio);
-		y = cubicBezier(y0, cy1, cy2, y3, ratio);
-		bezier_path.push_back(make_pair(x, y));
+		auto pt = getBezierPoint(x0, y0, ang1, getRowCoordinate(loc2), getColCoordinate(loc2), ang2, false, ratio);
+		bezier_path.push_back(make_pair((float) pt.first, (float) pt.second));
 	}
 
 	// iterate over bezier path to see which cells does it cross
@@ -771,19 +769,26 @@ list<pair<int, double> > Instance::getBezierPathCells(int loc1, double ang1, int
 	return cellPath;
 }
 
-list<list<pair<int, double> > > Instance::getPrimitives(int loc, double theta) const
+pair<double, double> Instance::getBezierPoint(double row1, double col1, double ang1,
+	double row2, double col2, double ang2, bool reverse, double ratio)
 {
-	list<list<pair<int, double> > > neighbors;
-	int x = getRowCoordinate(loc);
-	int y = getColCoordinate(loc);
-
-	if(abs(theta) < 0.1) {
-		theta = 0;
-	}
+	double sign = reverse ? -1 : 1;
+	// first control point
+	double cx1 = row1 - sign * sin(DEG2RAD(ang1));
+	double cy1 = col1 + sign * cos(DEG2RAD(ang1));
+	// second control point - behind the end point
+	double cx2 = row2 + sign * sin(DEG2RAD(ang2));
+	double cy2 = col2 - sign * cos(DEG2RAD(ang2));
 
-	// staying at the current location is also a neighbor
-	neighbors.push_back(list<pair<int, double> >{make_pair(loc, theta)});
+	auto cubicBezier = [] (double x0, double x1, double x2, double x3, double ratio) {
+		return pow((1 - ratio), 3)*x0 + 3*pow((1 - ratio), 2)*ratio*x1 + 3*(1 - ratio)*pow(ratio, 2)*x2 + pow(ratio, 3)*x3;
+	};
+	return make_pair(cubicBezier(row1, cx1, cx2, row2, ratio), cubicBezier(col1, cy1, cy2, col2, ratio));
+}
 
+list<tuple<int, int, double, bool> > Instance::getMotions(double theta)
+{
+	list<tuple<int, int, double, bool> > motions;
 	vector<pair<double, double> > angle_step_pair{
 								make_pair(WRAPTO360(theta - D_THETA), -1),
 								make_pair(WRAPTO360(theta - D_THETA), 1),
@@ -795,22 +800,43 @@ list<list<pair<int, double> > > Instance::getPrimitives(int loc, double theta) c
 								make_pair(WRAPTO360(theta + D_THETA/2), sqrt(5)), // +22.5, step = sqrt(5) --> hypot(2, 1)
 								make_pair(WRAPTO360(theta + D_THETA), -1),
 								make_pair(WRAPTO360(theta + D_THETA), 1)};
-	int new_x, new_y, new_loc, angle;
+	int angle;
 	double step;
 	for(auto angle_step : angle_step_pair)
 	{
 		tie(angle, step) = angle_step;
+		if(abs(step) > 1.01) // the longer primitives are not used
+			continue;
 		// sin, cos reversed since x is down (row), y is right (col)
-		new_x = (int) round((double) x - step*sin(DEG2RAD(angle)));
-		new_y = (int) round((double) y + step*cos(DEG2RAD(angle)));
-		new_loc = new_x * num_of_cols + new_y;
+		int row_step = (int) round(-step*sin(DEG2RAD(angle)));
+		int col_step = (int) round(step*cos(DEG2RAD(angle)));
+		motions.emplace_back(row_step, col_step, angle, step < 0);
+	}
+	return motions;
+}
 
-		if(abs(step) <= 1.01)
+list<list<pair<int, double> > > Instance::getPrimitives(int loc, double theta) const
+{
+	list<list<pair<int, double> > > neighbors;
+	int x = getRowCoordinate(loc);
+	int y = getColCoordinate(loc);
+
+	if(abs(theta) < 0.1) {
+		theta = 0;
+	}
+
+	// staying at the current location is also a neighbor
+	neighbors.push_back(list<pair<int, double> >{make_pair(loc, theta)});
+
+	int row_step, col_step, new_loc;
+	double angle;
+	for(const auto& motion : getMotions(theta))
+	{
+		tie(row_step, col_step, angle, std::ignore) = motion;
+		new_loc = (x + row_step) * num_of_cols + y + col_step;
+		if(validMove(loc, new_loc))
 		{
-			if(validMove(loc, new_loc))
-			{
-				neighbors.push_back(list<pair<int, double> >{make_pair(new_loc, angle)});
-			}
+			neighbors.push_back(list<pair<int, double> >{make_pair(new_loc, angle)});
 		}
 		// else
 		// {
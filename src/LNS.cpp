@@ -0,0 +1,342 @@
+#include "LNS.h"
+#include "SpaceTimeAStar.h"
+#include "SIPP.h"
+#include <algorithm>
+#include <numeric>
+
+
+LNS::LNS(const CBS& heuristic_source, const Instance& instance, bool sipp, int screen, int neighbor_size, bool cbs_replan) :
+	instance(instance), screen(screen), neighbor_size(max(1, neighbor_size)), cbs_replan(cbs_replan),
+	num_of_agents(instance.getDefaultNumberOfAgents()), rng(0)
+{
+	search_engines.resize(num_of_agents);
+	for (int i = 0; i < num_of_agents; i++)
+	{
+		if (sipp)
+			search_engines[i] = new SIPP(heuristic_source.getSearchEngine(i));
+		else
+			search_engines[i] = new SpaceTimeAStar(heuristic_source.getSearchEngine(i));
+	}
+	for (int loc = 0; loc < instance.map_size; loc++)
+	{
+		if (!instance.isObstacle(loc) && instance.getDegree(loc) > 2)
+			intersections.push_back(loc);
+	}
+	std::fill(weights, weights + NEIGHBORHOOD_COUNT, 1.0);
+}
+
+LNS::~LNS()
+{
+	for (auto engine : search_engines)
+		delete engine;
+}
+
+void LNS::run(const vector<Path>& initial_paths, double time_limit)
+{
+	start = std::chrono::steady_clock::now();
+	paths = initial_paths;
+	path_pointers.resize(num_of_agents);
+	for (int i = 0; i < num_of_agents; i++)
+		path_pointers[i] = &paths[i];
+	occupancy.reset(instance.map_size, instance.num_of_cols);
+	occupancy.sync(path_pointers);
+
+	// the shortest paths give the delays of the agents, and the lower bounds the low level returns on their costs
+	// give the lower bound, as the heuristic on the lattice can overestimate, so the paths may be longer
+	shortest_paths.resize(num_of_agents);
+	cost_lower_bounds.resize(num_of_agents);
+	lower_bound = 0;
+	for (int i = 0; i < num_of_agents; i++)
+	{
+		CBSNode root{};
+		ConstraintTable constraints(instance.num_of_cols, instance.map_size);
+		auto path = search_engines[i]->findSuboptimalPath(root, constraints, vector<Path*>(num_of_agents, nullptr), i, 0, 1);
+		shortest_paths[i] = path.first;
+		cost_lower_bounds[i] = path.second;
+		lower_bound += path.second;
+	}
+
+	initial_cost = solution_cost = getSumOfCosts();
+	trace.emplace_back(getRuntime(), solution_cost);
+	const double reaction = 0.1; // how fast the weights of the neighborhood types follow their success
+	while (solution_cost > lower_bound && getRuntime() < time_limit)
+	{
+		auto type = chooseNeighborhoodType();
+		set<int> neighborhood;
+		switch (type)
+		{
+		case RANDOM_AGENTS:
+			generateRandomNeighborhood(neighborhood);
+			break;
+		case INTERSECTION:
+			generateIntersectionNeighborhood(neighborhood);
+			break;
+		case DELAYED_AGENT:
+			generateDelayedAgentNeighborhood(neighborhood);
+			break;
+		default:
+			break;
+		}
+		num_iterations++;
+		num_tried[type]++;
+		bool succeeded = !neighborhood.empty() &&
+			replanNeighborhood(vector<int>(neighborhood.begin(), neighborhood.end()), time_limit - getRuntime());
+		weights[type] = (1 - reaction) * weights[type] + reaction * (succeeded ? 1 : 0);
+		if (!succeeded)
+			continue;
+		num_succeeded[type]++;
+		num_improvements++;
+		trace.emplace_back(getRuntime(), solution_cost);
+		if (screen > 1)
+			cout << "LNS iteration " << num_iterations << ": " << getNeighborhoodName(type) << " neighborhood of " <<
+				neighborhood.size() << " agents, cost " << solution_cost << endl;
+	}
+	runtime = getRuntime();
+	if (screen > 0)
+		printResults();
+}
+
+// roulette wheel over the weights, which never quite reach zero so that every type keeps a chance
+neighborhood_type LNS::chooseNeighborhoodType()
+{
+	double sum = 0;
+	for (int i = 0; i < NEIGHBORHOOD_COUNT; i++)
+		sum += max(weights[i], 0.01);
+	double r = std::uniform_real_distribution<double>(0, sum)(rng);
+	for (int i = 0; i < NEIGHBORHOOD_COUNT - 1; i++)
+	{
+		r -= max(weights[i], 0.01);
+		if (r < 0)
+			return (neighborhood_type)i;
+	}
+	return (neighborhood_type)(NEIGHBORHOOD_COUNT - 1);
+}
+
+void LNS::generateRandomNeighborhood(set<int>& neighborhood)
+{
+	std::uniform_int_distribution<int> agent(0, num_of_agents - 1);
+	while ((int)neighborhood.size() < min(neighbor_size, num_of_agents))
+		neighborhood.insert(agent(rng));
+}
+
+// the agents that visit the cells closest to a random intersection, in breadth-first order
+void LNS::generateIntersectionNeighborhood(set<int>& neighborhood)
+{
+	if (intersections.empty())
+		return;
+	int root = intersections[std::uniform_int_distribution<int>(0, (int)intersections.size() - 1)(rng)];
+	vector<bool> visited(instance.map_size, false);
+	list<int> open{root};
+	visited[root] = true;
+	vector<int> agents;
+	while (!open.empty() && (int)neighborhood.size() < neighbor_size)
+	{
+		int loc = open.front();
+		open.pop_front();
+		agents.clear();
+		occupancy.getAgentsVisiting(loc, 0, agents);
+		std::shuffle(agents.begin(), agents.end(), rng);
+		for (auto ag : agents)
+		{
+			if ((int)neighborhood.size() >= neighbor_size)
+				break;
+			neighborhood.insert(ag);
+		}
+		for (auto next : instance.getNeighbors(loc))
+		{
+			if (!visited[next])
+			{
+				visited[next] = true;
+				open.push_back(next);
+			}
+		}
+	}
+}
+
+// the delayed agent with the largest delay that is not tabu, and random agents that visit the cells of its
+// shortest path, as they are the ones that may keep it from taking it
+void LNS::generateDelayedAgentNeighborhood(set<int>& neighborhood)
+{
+	int delayed = -1;
+	int max_delay = 0;
+	for (int round = 0; round < 2 && delayed < 0; round++)
+	{
+		if (round == 1)
+			tabu.clear(); // all the delayed agents were tried
+		for (int i = 0; i < num_of_agents; i++)
+		{
+			int delay = (int)paths[i].size() - (int)shortest_paths[i].size();
+			if (delay > max_delay && std::find(tabu.begin(), tabu.end(), i) == tabu.end())
+			{
+				delayed = i;
+				max_delay = delay;
+			}
+		}
+	}
+	if (delayed < 0)
+		return;
+	tabu.push_back(delayed);
+	neighborhood.insert(delayed);
+
+	vector<int> candidates, agents;
+	for (const auto& entry : shortest_paths[delayed])
+	{
+		agents.clear();
+		occupancy.getAgentsVisiting(entry.location, 0, agents);
+		candidates.insert(candidates.end(), agents.begin(), agents.end());
+	}
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+	std::shuffle(candidates.begin(), candidates.end(), rng);
+	for (auto ag : candidates)
+	{
+		if ((int)neighborhood.size() >= neighbor_size)
+			break;
+		neighborhood.insert(ag);
+	}
+}
+
+bool LNS::replanNeighborhood(const vector<int>& neighborhood, double time_limit)
+{
+	int old_cost = 0;
+	for (auto ag : neighborhood)
+		old_cost += (int)paths[ag].size() - 1;
+
+	// the paths of the other agents are hard constraints
+	ConstraintTable reservations(instance.num_of_cols, instance.map_size);
+	vector<bool> in_neighborhood(num_of_agents, false);
+	for (auto ag : neighborhood)
+		in_neighborhood[ag] = true;
+	for (int i = 0; i < num_of_agents; i++)
+	{
+		if (!in_neighborhood[i])
+			reservations.insert2CT(paths[i]);
+	}
+
+	vector<Path> new_paths(neighborhood.size());
+	if (cbs_replan)
+	{
+		vector<SingleAgentSolver*> engines;
+		for (auto ag : neighborhood)
+			engines.push_back(search_engines[ag]);
+		vector<ConstraintTable> constraints(neighborhood.size(), reservations);
+		vector<Path> initial_paths; // planned by the sub-solver
+		CBS cbs(engines, constraints, initial_paths, 0);
+		cbs.setPrioritizeConflicts(true);
+		cbs.setHeuristicType(heuristics_type::CG, heuristics_type::ZERO);
+		cbs.setDisjointSplitting(false);
+		cbs.setBypass(false);
+		cbs.setRectangleReasoning(false);
+		cbs.setCorridorReasoning(true);
+		cbs.setTargetReasoning(true);
+		cbs.setWindow(0);
+		cbs.setMutexReasoning(false);
+		cbs.setConflictSelectionRule(conflict_selection::EARLIEST);
+		cbs.setNodeSelectionRule(node_selection::NODE_CONFLICTPAIRS);
+		cbs.setSavingStats(false);
+		cbs.setHighLevelSolver(high_level_solver_type::ASTAR, 1);
+		cbs.solve(min(time_limit, replan_time_limit), 0, old_cost); // gives up once it cannot beat the old paths
+		if (!cbs.solution_found || cbs.solution_cost >= old_cost)
+			return false;
+		for (int i = 0; i < (int)neighborhood.size(); i++)
+			new_paths[i] = cbs.getPath(i);
+	}
+	else
+	{
+		vector<int> order(neighborhood.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::shuffle(order.begin(), order.end(), rng);
+		CBSNode root{};
+		vector<Path*> no_paths(num_of_agents, nullptr);
+		int cost = 0;
+		for (auto i : order)
+		{
+			int ag = neighborhood[i];
+			new_paths[i] = search_engines[ag]->findOptimalPath(root, reservations, no_paths, ag, cost_lower_bounds[ag]);
+			// the heuristic on the lattice can overestimate, so the search may miss the old path when it is still free
+			if ((new_paths[i].empty() || new_paths[i].size() > paths[ag].size()) && isFree(paths[ag], reservations))
+				new_paths[i] = paths[ag];
+			if (new_paths[i].empty())
+				return false;
+			cost += (int)new_paths[i].size() - 1;
+			if (cost >= old_cost)
+				return false;
+			reservations.insert2CT(new_paths[i]);
+		}
+	}
+
+	for (int i = 0; i < (int)neighborhood.size(); i++)
+	{
+		int ag = neighborhood[i];
+		solution_cost += (int)new_paths[i].size() - (int)paths[ag].size();
+		paths[ag].swap(new_paths[i]);
+		occupancy.invalidate(ag); // changed in place
+	}
+	occupancy.sync(path_pointers);
+	return true;
+}
+
+bool LNS::isFree(const Path& path, const ConstraintTable& reservations)
+{
+	for (int t = 1; t < (int)path.size(); t++)
+	{
+		if (reservations.constrained(path[t].location, t) || reservations.constrained(path[t - 1].location, path[t].location, t))
+			return false;
+	}
+	return reservations.getHoldingTime(path.back().location, 0) < (int)path.size();
+}
+
+int LNS::getSumOfCosts() const
+{
+	int cost = 0;
+	for (const auto& path : paths)
+		cost += (int)path.size() - 1;
+	return cost;
+}
+
+string LNS::getNeighborhoodName(neighborhood_type type)
+{
+	switch (type)
+	{
+	case RANDOM_AGENTS:
+		return "random";
+	case INTERSECTION:
+		return "intersection";
+	case DELAYED_AGENT:
+		return "delayed agent";
+	default:
+		return "unknown";
+	}
+}
+
+void LNS::printResults() const
+{
+	cout << "LNS: cost " << initial_cost << " -> " << solution_cost << " (lower bound " << lower_bound << "), runtime " <<
+		runtime << " s, " << num_improvements << " improvements in " << num_iterations << " iterations (";
+	for (int i = 0; i < NEIGHBORHOOD_COUNT; i++)
+		cout << (i > 0 ? ", " : "") << getNeighborhoodName((neighborhood_type)i) << " " << num_succeeded[i] << "/" << num_tried[i];
+	cout << ")" << endl;
+}
+
+void LNS::saveTrace(const string& fileName) const
+{
+	std::ofstream output(fileName, std::ios::out);
+	output << "runtime,solution cost" << endl;
+	for (const auto& point : trace)
+		output << point.first << "," << point.second << endl;
+	output.close();
+}
+
+void LNS::savePaths(const string& fileName) const
+{
+	std::ofstream output(fileName, std::ios::out);
+	for (int i = 0; i < num_of_agents; i++)
+	{
+		output << "Agent " << i << ": ";
+		for (const auto& t : paths[i])
+			output << "(" << instance.getRowCoordinate(t.location) << "," << instance.getColCoordinate(t.location) <<
+				"," << t.theta << ")->";
+		output << endl;
+	}
+	output.close();
+}
@@ -0,0 +1,192 @@
+#include "Lifelong.h"
+#include <boost/tokenizer.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+
+Lifelong::Lifelong(ECBS& solver, const Instance& instance, int replan_interval, int screen) :
+	solver(solver), instance(instance), replan_interval(max(1, replan_interval)), screen(screen),
+	num_of_agents(instance.getDefaultNumberOfAgents()),
+	next_goals(num_of_agents), finished(num_of_agents, false), waiting(num_of_agents, false), executed_paths(num_of_agents)
+{
+	for (int i = 0; i < num_of_agents; i++)
+	{
+		locations.push_back(solver.getStartLocation(i));
+		goals.push_back(solver.getGoalLocation(i));
+		executed_paths[i].emplace_back(locations[i], solver.getSearchEngine(i).start_theta);
+	}
+}
+
+// The file has the number of agents in the first line, and then the goals of one agent per line as row,col,row,col,...
+// (the format of the agent files that are not scen files). The agents without a line have no more goals.
+bool Lifelong::loadGoals(const string& fileName)
+{
+	std::ifstream file(fileName);
+	if (!file.is_open())
+		return false;
+	string line;
+	getline(file, line);
+	int n = min(atoi(line.c_str()), num_of_agents);
+	boost::char_separator<char> sep(",");
+	for (int i = 0; i < n && getline(file, line); i++)
+	{
+		boost::tokenizer< boost::char_separator<char> > tok(line, sep);
+		auto it = tok.begin();
+		while (it != tok.end())
+		{
+			int row = atoi(it->c_str());
+			if (++it == tok.end())
+				break;
+			int col = atoi(it->c_str());
+			++it;
+			if (row < 0 || row >= instance.num_of_rows || col < 0 || col >= instance.num_of_cols ||
+				instance.isObstacle(instance.linearizeCoordinate(row, col)))
+			{
+				cerr << "Goal (" << row << "," << col << ") of agent " << i << " is not a free cell" << endl;
+				return false;
+			}
+			next_goals[i].push_back(instance.linearizeCoordinate(row, col));
+		}
+	}
+	return true;
+}
+
+void Lifelong::run(int simulation_time, double replan_time_limit)
+{
+	auto start = std::chrono::steady_clock::now();
+	while (timestep < simulation_time && std::find(finished.begin(), finished.end(), false) != finished.end())
+	{
+		for (int i = 0; i < num_of_agents; i++)
+		{
+			if (waiting[i])
+				assignNextGoal(i);
+		}
+		solver.clear();
+		vector<PathEntry> starts; // the agents go on with the headings they arrived with
+		for (const auto& path : executed_paths)
+			starts.push_back(path.back());
+		solver.setTasks(starts, goals);
+		auto replan_start = std::chrono::steady_clock::now();
+		solver.solve(replan_time_limit);
+		latencies.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - replan_start).count());
+		num_replans++;
+		if (!solver.solution_found)
+			num_failed_replans++;
+		if (screen > 0)
+			cout << "Replan " << num_replans << " at timestep " << timestep << ": " <<
+				(solver.solution_found ? "solved" : "no plan, so the agents wait") << " in " << latencies.back() << " s" << endl;
+		execute(solver.solution_found, min(replan_interval, simulation_time - timestep));
+	}
+	runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// An agent completes its task when it arrives at the end of its path, which is its goal, and then it waits there
+// until the next replan gives it its next goal.
+void Lifelong::execute(bool solved, int steps)
+{
+	vector<bool> arrived(num_of_agents, false);
+	for (int t = 1; t <= steps; t++)
+	{
+		timestep++;
+		for (int i = 0; i < num_of_agents; i++)
+		{
+			if (!solved)
+			{
+				executed_paths[i].push_back(executed_paths[i].back());
+				continue;
+			}
+			const auto& path = solver.getPath(i);
+			executed_paths[i].push_back(path[min(t, (int)path.size() - 1)]);
+			locations[i] = executed_paths[i].back().location;
+			if (finished[i] || waiting[i] || arrived[i] || t < (int)path.size() - 1)
+				continue;
+			arrived[i] = true;
+			num_tasks_completed++;
+			assignNextGoal(i);
+		}
+	}
+}
+
+// Two agents cannot hold the same goal, so an agent whose next goal is the current goal of another agent stays where
+// it is until that goal is free.
+void Lifelong::assignNextGoal(int agent)
+{
+	waiting[agent] = false;
+	if (next_goals[agent].empty())
+	{
+		finished[agent] = true;
+		return;
+	}
+	int goal = next_goals[agent].front();
+	for (int i = 0; i < num_of_agents; i++)
+	{
+		if (i != agent && goals[i] == goal)
+		{
+			waiting[agent] = true;
+			goals[agent] = locations[agent];
+			return;
+		}
+	}
+	goals[agent] = goal;
+	next_goals[agent].pop_front();
+}
+
+double Lifelong::getLatency(double percentile) const
+{
+	if (latencies.empty())
+		return 0;
+	vector<double> sorted(latencies);
+	std::sort(sorted.begin(), sorted.end());
+	int rank = (int)std::ceil(percentile / 100 * sorted.size());
+	return sorted[min(max(rank, 1), (int)sorted.size()) - 1];
+}
+
+void Lifelong::printResults() const
+{
+	cout << "Lifelong: " << num_tasks_completed << " tasks in " << timestep << " timesteps (throughput " <<
+		getThroughput() << "), " << num_replans << " replans (" << num_failed_replans << " failed), latency p50 " <<
+		getLatency(50) << " s, p90 " << getLatency(90) << " s, p99 " << getLatency(99) << " s, max " <<
+		getLatency(100) << " s, heuristic tables " << solver.num_heuristic_cache_hits << " cached, " <<
+		solver.num_heuristic_cache_misses << " computed, " << solver.num_heuristic_cache_evictions << " evicted" << endl;
+}
+
+void Lifelong::saveResults(const string& fileName, const string& instanceName) const
+{
+	std::ifstream infile(fileName);
+	bool exist = infile.good();
+	infile.close();
+	if (!exist)
+	{
+		ofstream addHeads(fileName);
+		addHeads << "runtime,#timesteps,#tasks completed,throughput,#replans,#failed replans," <<
+			"latency p50,latency p90,latency p99,max latency," <<
+			"#cached heuristic tables,#computed heuristic tables," <<
+			"#high-level expanded,#high-level generated,#low-level expanded,#low-level generated,instance name," <<
+			"#evicted heuristic tables" << endl;
+		addHeads.close();
+	}
+	ofstream stats(fileName, std::ios::app);
+	stats << runtime << "," << timestep << "," << num_tasks_completed << "," << getThroughput() << "," <<
+		num_replans << "," << num_failed_replans << "," <<
+		getLatency(50) << "," << getLatency(90) << "," << getLatency(99) << "," << getLatency(100) << "," <<
+		solver.num_heuristic_cache_hits << "," << solver.num_heuristic_cache_misses << "," <<
+		solver.num_HL_expanded << "," << solver.num_HL_generated << "," <<
+		solver.num_LL_expanded << "," << solver.num_LL_generated << "," << instanceName << "," <<
+		solver.num_heuristic_cache_evictions << endl;
+	stats.close();
+}
+
+void Lifelong::savePaths(const string& fileName) const
+{
+	std::ofstream output(fileName, std::ios::out);
+	for (int i = 0; i < num_of_agents; i++)
+	{
+		output << "Agent " << i << ": ";
+		for (const auto& t : executed_paths[i])
+			output << "(" << instance.getRowCoordinate(t.location) << "," << instance.getColCoordinate(t.location) <<
+				"," << t.theta << ")->";
+		output << endl;
+	}
+	output.close();
+}
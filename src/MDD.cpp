@@ -1,7 +1,72 @@
 #include "MDD.h"
 #include <iostream>
+#include <algorithm>
 #include "common.h"
 
+static bool lessWordIndex(const pair<int, uint64_t>& word, int index) { return word.first < index; }
+
+void CellBitset::set(int cell)
+{
+	int index = cell >> 6;
+	auto it = std::lower_bound(words.begin(), words.end(), index, lessWordIndex);
+	if (it == words.end() || it->first != index)
+		it = words.emplace(it, index, 0);
+	it->second |= (uint64_t)1 << (cell & 63);
+}
+
+void CellBitset::reset(int cell)
+{
+	int index = cell >> 6;
+	auto it = std::lower_bound(words.begin(), words.end(), index, lessWordIndex);
+	if (it == words.end() || it->first != index)
+		return;
+	it->second &= ~((uint64_t)1 << (cell & 63));
+	if (it->second == 0)
+		words.erase(it);
+}
+
+bool CellBitset::test(int cell) const
+{
+	int index = cell >> 6;
+	auto it = std::lower_bound(words.begin(), words.end(), index, lessWordIndex);
+	return it != words.end() && it->first == index && (it->second >> (cell & 63)) & 1;
+}
+
+int CellBitset::count() const
+{
+	int rst = 0;
+	for (const auto& word : words)
+		rst += __builtin_popcountll(word.second);
+	return rst;
+}
+
+bool CellBitset::isSingleton(int cell) const
+{
+	return words.size() == 1 && words.front().first == (cell >> 6) &&
+		words.front().second == (uint64_t)1 << (cell & 63);
+}
+
+bool CellBitset::intersects(const CellBitset& other) const
+{
+	auto it1 = words.begin();
+	auto it2 = other.words.begin();
+	while (it1 != words.end() && it2 != other.words.end())
+	{
+		if (it1->first < it2->first)
+			++it1;
+		else if (it2->first < it1->first)
+			++it2;
+		else if (it1->second & it2->second)
+			return true;
+		else
+		{
+			++it1;
+			++it2;
+		}
+	}
+	return false;
+}
+
 /*bool MDD::isConstrained(int curr_id, int next_id, int next_timestep, const std::vector< std::list< std::pair<int, int> > >& cons)  const
 {
 	if (cons.empty())
@@ -42,6 +107,7 @@ bool MDD::buildMDD(ConstraintTable& constraint_table, const SingleAgentSolver* _
 			{
 				return (s1 == s2) || (s1 && s2 &&
 					s1->location == s2->location &&
+					s1->theta == s2->theta &&
 					s1->timestep == s2->timestep);
 			}
 		};
@@ -49,9 +115,9 @@ bool MDD::buildMDD(ConstraintTable& constraint_table, const SingleAgentSolver* _
 		{
 			size_t operator()(const Node* n) const
 			{
-				size_t loc_hash = std::hash<int>()(n->location);
+				size_t state_hash = std::hash<int>()(n->location * NUM_HEADINGS + HEADING_INDEX(n->theta));
 				size_t timestep_hash = std::hash<int>()(n->timestep);
-				return (loc_hash ^ (timestep_hash << 1));
+				return (state_hash ^ (timestep_hash << 1));
 			}
 		};
 		//Node() = default;
@@ -59,7 +125,7 @@ bool MDD::buildMDD(ConstraintTable& constraint_table, const SingleAgentSolver* _
 	};
 	this->solver = _solver;
 	int holding_time = constraint_table.getHoldingTime(solver->goal_location, constraint_table.length_min); // the earliest timestep that the agent can hold its goal location. The length_min is considered here.
-	auto root = new Node(solver->start_location, 0, 0, solver->my_heuristic[solver->start_location]); // Root
+	auto root = new Node(solver->start_location, solver->start_theta, 0, solver->my_heuristic[solver->start_location]); // Root
 	// generate a heap that can save nodes (and a open_handle)
 	pairing_heap< Node*, compare<Node::compare_node> > open;
 	unordered_set<Node*, Node::NodeHasher, Node::eqnode> allNodes_table;
@@ -88,6 +154,8 @@ bool MDD::buildMDD(ConstraintTable& constraint_table, const SingleAgentSolver* _
 		for (auto next_location : next_locations) // Try every possible move. We only add backward edges in this step.
 		{
 			int next_timestep = curr->timestep + 1;
+			if (next_timestep > upperbound) // the heuristic can be negative near the goal, so bound the level as well
+				continue;
 			if (constraint_table.constrained(next_location.first, next_timestep) ||
 				constraint_table.constrained(curr->location, next_location.first, next_timestep))
 				continue;
@@ -119,23 +187,38 @@ bool MDD::buildMDD(ConstraintTable& constraint_table, const SingleAgentSolver* _
 	}
 
 	// Backward
-	assert(goal_node != nullptr);
+	if (goal_node == nullptr) // the heuristic on the lattice can overestimate, which prunes the paths that are tight on length_max
+	{
+		for (auto it : allNodes_table)
+			delete it;
+		return false;
+	}
 	levels.resize(goal_node->timestep + 1);
 	list<Node*> Q;
-	goal_node->mdd_node = new MDDNode(goal_node->location, goal_node->timestep);
-	levels.back().push_back(goal_node->mdd_node);
-	Q.push_back(goal_node);
+	for (auto it : allNodes_table) // the goal can be reached with different headings
+	{
+		if (it->location != solver->goal_location || it->timestep != goal_node->timestep)
+			continue;
+		bool arrive = false; // whether the agent arrives at the goal location at this timestep
+		for (auto parent : it->parents)
+			arrive = arrive || parent->location != solver->goal_location;
+		if (!arrive)
+			continue;
+		it->mdd_node = new MDDNode(it->location, it->theta, it->timestep);
+		levels.back().push_back(it->mdd_node);
+		Q.push_back(it);
+	}
 	while (!Q.empty())
 	{
 		auto curr = Q.back();
 		Q.pop_back();
 		for (auto parent : curr->parents)
 		{
-			if (curr == goal_node && parent->location == goal_node->location) 
+			if (curr->timestep == goal_node->timestep && parent->location == solver->goal_location)
 				continue;  // the parent of the goal node should not be at the goal location
 			if (parent->mdd_node == nullptr) // a new node
 			{
-				parent->mdd_node = new MDDNode(parent->location, parent->timestep);
+				parent->mdd_node = new MDDNode(parent->location, parent->theta, parent->timestep);
 				levels[parent->timestep].push_back(parent->mdd_node);
 				Q.push_back(parent);
 			}
@@ -148,6 +231,7 @@ bool MDD::buildMDD(ConstraintTable& constraint_table, const SingleAgentSolver* _
 	for (auto it : allNodes_table)
 		delete it;
     assert(levels.back().front()->location == solver->goal_location);
+	buildLevelCells();
 	return true;
 }
 
@@ -157,9 +241,10 @@ bool MDD::buildMDD(const ConstraintTable& ct,
 {
     cout << "\nInside build MDD";
 	this->solver = _solver;
-    auto root = new MDDNode(solver->start_location, 0, nullptr); // Root
+    auto root = new MDDNode(solver->start_location, solver->start_theta, nullptr); // Root
 	std::queue<MDDNode*> open;
 	list<MDDNode*> closed;
+	unordered_map<int, MDDNode*> next_level; // (location, heading) -> node at the level after curr
 	open.push(root);
 	closed.push_back(root);
 	levels.resize(num_of_levels);
@@ -170,16 +255,17 @@ bool MDD::buildMDD(const ConstraintTable& ct,
 		// cout << "\nCurr level: " << curr->level;
 		open.pop();
 		// Here we suppose all edge cost equals 1
-		if (curr->level == num_of_levels - 1)
+		if (curr->level == num_of_levels - 1) // only the goal location is kept at the last level
 		{
 			levels.back().push_back(curr);
-			assert(open.empty());
-			break;
+			continue;
 		}
 		// We want (g + 1)+h <= f = numOfLevels - 1, so h <= numOfLevels - g - 2. -1 because it's the bound of the children.
 		// cout << "\nnum levels: " << num_of_levels;
 		// cout << "\n curr level: " << curr->level;
 		int heuristicBound = num_of_levels - curr->level - 2;
+		if (!next_level.empty() && next_level.begin()->second->level != curr->level + 1)
+			next_level.clear();
 		// cout << "\nheuristic bound: " << heuristicBound;
 		list<pair<int,double>> next_locations = solver->getNextLocations(curr->location,curr->theta);
 		// cout << "\nNumber of neighbors found: " << next_locations.size();
@@ -188,27 +274,25 @@ bool MDD::buildMDD(const ConstraintTable& ct,
 			// cout << "\nMy heuristic: " << solver->my_heuristic[next_location.first];
 			// cout << "\nVertex constrained: " << ct.constrained(next_location.first, curr->level + 1);
 			// cout << "\nEdge constrained: " << ct.constrained(curr->location, next_location.first, curr->level + 1);
+			if (curr->level + 1 == num_of_levels - 1 && next_location.first != solver->goal_location)
+				continue; // the heuristic can be negative near the goal, so it does not exclude other locations here
 			if (!ct.constrained(next_location.first, curr->level + 1) &&
 			    solver->my_heuristic[next_location.first] <= heuristicBound &&
 				!ct.constrained(curr->location, next_location.first, curr->level + 1)) // valid move
 			{
-				auto child = closed.rbegin();
-				bool find = false;
-				for (; child != closed.rend() && ((*child)->level == curr->level + 1); ++child)
+				int state = next_location.first * NUM_HEADINGS + HEADING_INDEX(next_location.second);
+				auto child = next_level.find(state);
+				if (child != next_level.end()) // If the child node exists
 				{
-					if ((*child)->location == next_location.first) // If the child node exists
-					{
-						(*child)->parents.push_back(curr); // then add corresponding parent link and child link
-						find = true;
-						break;
-					}
+					child->second->parents.push_back(curr); // then add corresponding parent link and child link
 				}
-				if (!find) // Else generate a new mdd node
+				else // Else generate a new mdd node
 				{
 					auto childNode = new MDDNode(next_location.first,next_location.second,curr);
                     childNode->cost = num_of_levels - 1;
 					open.push(childNode);
 					closed.push_back(childNode);
+					next_level[state] = childNode;
 				}
 			}
 			// cout << "\nNeighbor discarded";
@@ -216,17 +300,28 @@ bool MDD::buildMDD(const ConstraintTable& ct,
 		// cout << "\nSize of open list: " << open.size();
 	}
 	// cout << "\nlevels size: " << levels.back().size();
-	assert(levels.back().size() == 1);
+	assert(!levels.back().empty());
 
 	cout << "\nBakctracking from goal";
 	// Backward
-	auto goal_node = levels.back().back();
-	for (auto parent : goal_node->parents)
+	list<MDDNode*> unreachable_goals;
+	for (auto goal_node = levels.back().begin(); goal_node != levels.back().end() && num_of_levels > 1;)
 	{
-		if (parent->location == goal_node->location) // the parent of the goal node should not be at the goal location
+		// the parent of the goal node should not be at the goal location
+		(*goal_node)->parents.remove_if([&](MDDNode* parent) { return parent->location == (*goal_node)->location; });
+		if ((*goal_node)->parents.empty())
+		{
+			unreachable_goals.push_back(*goal_node);
+			goal_node = levels.back().erase(goal_node);
 			continue;
-		levels[num_of_levels - 2].push_back(parent);
-		parent->children.push_back(goal_node); // add forward edge	
+		}
+		for (auto parent : (*goal_node)->parents)
+		{
+			if (parent->children.empty()) // a new node
+				levels[num_of_levels - 2].push_back(parent);
+			parent->children.push_back(*goal_node); // add forward edge
+		}
+		++goal_node;
 	}
 	for (int t = num_of_levels - 2; t > 0; t--)
 	{
@@ -247,10 +342,13 @@ bool MDD::buildMDD(const ConstraintTable& ct,
 
 	// Delete useless nodes (nodes who don't have any children)
 	for (auto it : closed)
-		if (it->children.empty() && it->level < num_of_levels - 1)
+		if (it->level < num_of_levels - 1 && it->children.empty())
 			delete it;
 	closed.clear();
+	for (auto it : unreachable_goals)
+		delete it;
     assert(levels.back().front()->location == solver->goal_location);
+	buildLevelCells();
 	return true;
 }
 
@@ -333,6 +431,15 @@ bool MDD::buildMDD(const ConstraintTable& ct,
 void MDD::deleteNode(MDDNode* node)
 {
 	levels[node->level].remove(node);
+	if (node->level < (int)level_cells.size())
+	{
+		level_states[node->level].reset(node->getState());
+		bool cell_used = false; // another heading may still occupy the cell
+		for (auto it : levels[node->level])
+			cell_used = cell_used || it->location == node->location;
+		if (!cell_used)
+			level_cells[node->level].reset(node->location);
+	}
 	for (auto child = node->children.begin(); child != node->children.end(); ++child)
 	{
 		(*child)->parents.remove(node);
@@ -347,6 +454,66 @@ void MDD::deleteNode(MDDNode* node)
 	}
 }
 
+// remove the nodes and edges that violate the given constraints, and then the nodes that are no longer on any path
+bool MDD::prune(const ConstraintTable& ct)
+{
+	if (levels.empty() || levels[0].empty() || ct.constrained(levels[0].front()->location, 0))
+		return false;
+	for (int t = 1; t < (int)levels.size(); t++)
+	{
+		for (auto node : levels[t])
+		{
+			if (ct.constrained(node->location, t))
+			{
+				for (auto parent : node->parents)
+					parent->children.remove(node);
+				node->parents.clear();
+			}
+			else
+			{
+				node->parents.remove_if([&](MDDNode* parent) {
+					if (!ct.constrained(parent->location, node->location, t))
+						return false;
+					parent->children.remove(node);
+					return true;
+				});
+			}
+		}
+	}
+	for (int t = 1; t < (int)levels.size(); t++) // nodes that cannot be reached from the start
+	{
+		for (auto node = levels[t].begin(); node != levels[t].end();)
+		{
+			if (!(*node)->parents.empty())
+			{
+				++node;
+				continue;
+			}
+			for (auto child : (*node)->children)
+				child->parents.remove(*node);
+			delete *node;
+			node = levels[t].erase(node);
+		}
+	}
+	for (int t = (int)levels.size() - 2; t >= 0; t--) // nodes that cannot reach the goal
+	{
+		for (auto node = levels[t].begin(); node != levels[t].end();)
+		{
+			if (!(*node)->children.empty())
+			{
+				++node;
+				continue;
+			}
+			for (auto parent : (*node)->parents)
+				parent->children.remove(*node);
+			delete *node;
+			node = levels[t].erase(node);
+		}
+	}
+	buildLevelCells();
+	return !levels[0].empty() && !levels.back().empty();
+}
+
 void MDD::clear()
 {
 	if(levels.empty())
@@ -357,48 +524,83 @@ void MDD::clear()
 			delete it;
 	}
 	levels.clear();
+	level_cells.clear();
+	level_states.clear();
 }
 
-MDDNode* MDD::find(int location, int level) const
+void MDD::buildLevelCells()
 {
+	level_cells.assign(levels.size(), CellBitset());
+	level_states.assign(levels.size(), CellBitset());
+	for (size_t t = 0; t < levels.size(); t++)
+	{
+		for (auto node : levels[t])
+		{
+			level_cells[t].set(node->location);
+			level_states[t].set(node->getState());
+		}
+	}
+}
+
+size_t MDD::getMemoryUsage() const
+{
+	const size_t list_node_bytes = 3 * sizeof(void*); // prev, next and the stored pointer
+	size_t bytes = sizeof(MDD) + levels.capacity() * sizeof(list<MDDNode*>);
+	for (const auto& level : levels)
+	{
+		bytes += level.size() * list_node_bytes;
+		for (auto node : level)
+			bytes += sizeof(MDDNode) + (node->children.size() + node->parents.size()) * list_node_bytes;
+	}
+	for (const auto& cells : level_cells)
+		bytes += cells.getMemoryUsage();
+	for (const auto& states : level_states)
+		bytes += states.getMemoryUsage();
+	return bytes;
+}
+
+MDDNode* MDD::find(int location, double theta, int level) const
+{
+	if (level < (int)level_states.size() && !level_states[level].test(location * NUM_HEADINGS + HEADING_INDEX(theta)))
+		return nullptr;
 	if(level < (int)levels.size())
 		for (auto it : levels[level])
-			if(it->location == location)
+			if(it->location == location && it->theta == theta)
 				return it;
 	return nullptr;
 }
 
 MDD::MDD(const MDD & cpy) // deep copy
 {
+	// the copies are matched to the nodes by pointer, so every edge is copied even if two nodes share a state
+	unordered_map<const MDDNode*, MDDNode*> copies;
 	levels.resize(cpy.levels.size());
-	auto root = new MDDNode(cpy.levels[0].front()->location, cpy.levels[0].front()->theta, nullptr);
-	levels[0].push_back(root);
-	for(size_t t = 0; t < levels.size() - 1; t++)
+	for (size_t t = 0; t < cpy.levels.size(); t++)
 	{
-		for (auto node = levels[t].begin(); node != levels[t].end(); ++node)
+		for (auto cpyNode : cpy.levels[t])
 		{
-			MDDNode* cpyNode = cpy.find((*node)->location, (*node)->level);
-			for (list<MDDNode*>::const_iterator cpyChild = cpyNode->children.begin(); cpyChild != cpyNode->children.end(); ++cpyChild)
+			auto node = new MDDNode(cpyNode->location, cpyNode->theta, cpyNode->level);
+			node->cost = cpyNode->cost;
+			levels[t].push_back(node);
+			copies[cpyNode] = node;
+		}
+	}
+	for (size_t t = 0; t + 1 < cpy.levels.size(); t++)
+	{
+		for (auto cpyNode : cpy.levels[t])
+		{
+			auto node = copies[cpyNode];
+			for (auto cpyChild : cpyNode->children)
 			{
-				MDDNode* child = find((*cpyChild)->location, (*cpyChild)->level);
-				if (child == nullptr)
-				{
-					child = new MDDNode((*cpyChild)->location,(*cpyChild)->theta,(*node));
-          child->cost = (*cpyChild)->cost;
-					levels[child->level].push_back(child);
-					(*node)->children.push_back(child);
-				}
-				else
-				{
-					child->parents.push_back(*node);
-					(*node)->children.push_back(child);
-				}
+				auto child = copies[cpyChild];
+				node->children.push_back(child);
+				child->parents.push_back(node);
 			}
 		}
-		
 	}
 
   solver = cpy.solver;
+  buildLevelCells();
 }
 
 MDD::~MDD()
@@ -410,10 +612,14 @@ void MDD::increaseBy(const ConstraintTable&ct, int dLevel, SingleAgentSolver* so
   auto oldHeight = levels.size();
   auto numOfLevels = levels.size() + dLevel;
 	levels.resize(numOfLevels);
+  level_cells.clear(); // rebuilt once the new levels are complete
+  level_states.clear();
   for (int l = 0; l < numOfLevels - 1; l++){
     double heuristicBound = numOfLevels - l - 2+ 0.001;
 
-    auto node_map = collectMDDlevel(this, l + 1);
+    unordered_map<int, MDDNode*> node_map; // (location, heading) -> node at level l + 1
+    for (auto node : levels[l + 1])
+      node_map[node->getState()] = node;
 
     for (auto & it: levels[l]){
       MDDNode* node_ptr = it;
@@ -427,12 +633,13 @@ void MDD::increaseBy(const ConstraintTable&ct, int dLevel, SingleAgentSolver* so
               !ct.constrained(newLoc.first, it->level + 1) &&
               !ct.constrained(it->location, newLoc.first, it->level + 1)) // valid move
             {
-              if (node_map.find(newLoc.first) == node_map.end()){
+              int state = newLoc.first * NUM_HEADINGS + HEADING_INDEX(newLoc.second);
+              if (node_map.find(state) == node_map.end()){
                 auto newNode = new MDDNode(newLoc.first, newLoc.second, node_ptr);
                 levels[l + 1].push_back(newNode);
-                node_map[newLoc.first] = newNode;
+                node_map[state] = newNode;
               }else{
-                node_map[newLoc.first]->parents.push_back(node_ptr);
+                node_map[state]->parents.push_back(node_ptr);
               }
             }
         }
@@ -479,6 +686,7 @@ void MDD::increaseBy(const ConstraintTable&ct, int dLevel, SingleAgentSolver* so
       }
     }
   }
+  buildLevelCells();
 }
 
 MDDNode* MDD::goalAt(int level){
@@ -525,19 +733,19 @@ std::ostream& operator<<(std::ostream& os, const MDD& mdd)
 SyncMDD::SyncMDD(const MDD & cpy) // deep copy of a MDD
 {
 	levels.resize(cpy.levels.size());
-	auto root = new SyncMDDNode(cpy.levels[0].front()->location, nullptr);
+	auto root = new SyncMDDNode(cpy.levels[0].front()->location, cpy.levels[0].front()->theta, nullptr);
 	levels[0].push_back(root);
 	for (int t = 0; t < (int)levels.size() - 1; t++)
 	{
 		for (auto node = levels[t].begin(); node != levels[t].end(); ++node)
 		{
-			MDDNode* cpyNode = cpy.find((*node)->location, t);
+			MDDNode* cpyNode = cpy.find((*node)->location, (*node)->theta, t);
 			for (list<MDDNode*>::const_iterator cpyChild = cpyNode->children.begin(); cpyChild != cpyNode->children.end(); ++cpyChild)
 			{
-				SyncMDDNode* child = find((*cpyChild)->location, (*cpyChild)->level);
+				SyncMDDNode* child = find((*cpyChild)->location, (*cpyChild)->theta, (*cpyChild)->level);
 				if (child == nullptr)
 				{
-					child = new SyncMDDNode((*cpyChild)->location, (*node));
+					child = new SyncMDDNode((*cpyChild)->location, (*cpyChild)->theta, (*node));
 					levels[t + 1].push_back(child);
 					(*node)->children.push_back(child);
 				}
@@ -552,11 +760,11 @@ SyncMDD::SyncMDD(const MDD & cpy) // deep copy of a MDD
 	}
 }
 
-SyncMDDNode* SyncMDD::find(int location, int level) const
+SyncMDDNode* SyncMDD::find(int location, double theta, int level) const
 {
 	if (level < (int)levels.size())
 		for (auto it : levels[level])
-			if (it->location == location)
+			if (it->location == location && it->theta == theta)
 				return it;
 	return nullptr;
 }
@@ -602,7 +810,7 @@ MDD* MDDTable::findMDD(HLNode& node, int agent) const
     ConstraintsHasher c(agent, &node);
     auto got = lookupTable[c.a].find(c);
     if (got != lookupTable[c.a].end())
-        return got->second;
+        return got->second.mdd;
     else
         return nullptr;
 }
@@ -619,38 +827,53 @@ MDD * MDDTable::getMDD(HLNode& node, int id, size_t mdd_levels)
 	if (got != lookupTable[c.a].end())
 	{
 		cout << "\nIn lookup table";
-		assert((node.getName() == "CBS Node" &&  got->second->levels.size() == mdd_levels) ||
-			(node.getName() == "ECBS Node" &&  got->second->levels.size() <= mdd_levels));
-		return got->second;
+		assert((node.getName() == "CBS Node" &&  got->second.mdd->levels.size() == mdd_levels) ||
+			(node.getName() == "ECBS Node" &&  got->second.mdd->levels.size() <= mdd_levels));
+		lru_list.splice(lru_list.begin(), lru_list, got->second.lru_handle);
+		num_hits++;
+		return got->second.mdd;
 	}
 	cout << "\nNot in lookup table";
-	releaseMDDMemory(id);
+	num_misses++;
 	clock_t t = clock();
 	cout << "\nCreating a new MDD object";
-	MDD * mdd = new MDD();
-	cout << "\nCreating a constraint table for this agent";
-	ConstraintTable ct(initial_constraints[id]);
-	cout << "\nInserting constraint for the node into the constraint table";
-    ct.insert2CT(node, id);
-	cout << "\nBuild the MDD for the node";
-	cout << "\nNode name: " << node.getName();
-	if (node.getName() == "CBS Node"){
-		cout << "\nBuilding MDD for a CBS node";
-		mdd->buildMDD(ct, mdd_levels, search_engines[id]);
-		cout << "\nFinished building MDD";
-	}
-	else{
-		cout << "\nBuilding MDD for ECBS node";
-		mdd->buildMDD(ct, search_engines[id]);
-		cout << "\nFinished building MDD";
-	} // ECBS node
+	MDD * mdd = deriveMDD(node, id, mdd_levels);
+	if (mdd != nullptr)
+	{
+		num_derived_mdds++;
+	}
+	else
+	{
+		mdd = new MDD();
+		cout << "\nCreating a constraint table for this agent";
+		ConstraintTable ct(initial_constraints[id]);
+		cout << "\nInserting constraint for the node into the constraint table";
+		ct.insert2CT(node, id);
+		cout << "\nBuild the MDD for the node";
+		cout << "\nNode name: " << node.getName();
+		if (node.getName() == "CBS Node"){
+			cout << "\nBuilding MDD for a CBS node";
+			mdd->buildMDD(ct, mdd_levels, search_engines[id]);
+			cout << "\nFinished building MDD";
+		}
+		else{
+			cout << "\nBuilding MDD for ECBS node";
+			mdd->buildMDD(ct, search_engines[id]);
+			cout << "\nFinished building MDD";
+		} // ECBS node
+	}
 	cout << "\nCheck if lookuptable is empty";
 	if (!lookupTable.empty())
 	{
 		// ConstraintsHasher c(id, &node);
 		cout << "\nLookupTable not empty";
-		lookupTable[c.a][c] = mdd;
+		lru_list.push_front(c);
+		size_t bytes = mdd->getMemoryUsage();
+		lookupTable[c.a][c] = CachedMDD{mdd, bytes, lru_list.begin()};
+		memory_usage += bytes;
+		peak_memory = max(peak_memory, memory_usage);
 		cout << "\nAdded MDD to lookup table";
+		releaseMDDMemory();
 	}
 	accumulated_runtime += (double)(clock() - t) / CLOCKS_PER_SEC;
 	cout << "\nCalculated accumulated runtime";
@@ -667,31 +890,50 @@ MDD * MDDTable::getMDD(HLNode& node, int id, size_t mdd_levels)
 		delete mdd;
 }*/
 
-void MDDTable::releaseMDDMemory(int id)
+// Copy the MDD of the parent CT node and prune it with the new constraints of the given node.
+// Return nullptr if the parent MDD is not cached or the node needs an MDD with a different number of levels.
+MDD* MDDTable::deriveMDD(HLNode& node, int id, size_t mdd_levels) const
 {
-	cout << "\nReleasing MDD memory";
-	if (id < 0 || lookupTable.empty() || (int)lookupTable[id].size() < max_num_of_mdds)
-		return;
-	int minLength = MAX_TIMESTEP;
-	for (auto mdd : lookupTable[id])
+	if (node.parent == nullptr || lookupTable.empty())
+		return nullptr;
+	auto got = lookupTable[id].find(ConstraintsHasher(id, node.parent));
+	if (got == lookupTable[id].end())
+		return nullptr;
+	const MDD* parent_mdd = got->second.mdd;
+	if ((node.getName() == "CBS Node" && parent_mdd->levels.size() != mdd_levels) ||
+		parent_mdd->levels.size() > mdd_levels || parent_mdd->levels.empty())
+		return nullptr;
+	ConstraintTable ct(initial_constraints[id].num_col, initial_constraints[id].map_size);
+	ct.insert2CT(node.constraints, id);
+	int goal_level = (int)parent_mdd->levels.size() - 1;
+	if (ct.length_max < goal_level ||
+		ct.getHoldingTime(search_engines[id]->goal_location, ct.length_min) > goal_level)
+		return nullptr; // the agent cannot finish at the last level any more
+	auto mdd = new MDD(*parent_mdd);
+	if (!mdd->prune(ct))
 	{
-		if ((int)mdd.second->levels.size() < minLength)
-			minLength = mdd.second->levels.size();
+		mdd->clear();
+		delete mdd;
+		return nullptr;
 	}
-	for (auto mdd = lookupTable[id].begin(); mdd != lookupTable[id].end();)
+	return mdd;
+}
+
+void MDDTable::releaseMDDMemory()
+{
+	// the two most recently used MDDs are kept, as callers usually hold the MDDs of both agents in a conflict
+	while (memory_usage > memory_limit && lru_list.size() > 2)
 	{
-		if ((int)mdd->second->levels.size() == minLength)
-		{
-			delete mdd->second;
-			mdd = lookupTable[id].erase(mdd);
-			num_released_mdds++;
-		}
-		else
-		{
-			mdd++;
-		}
+		const auto& key = lru_list.back();
+		auto mdd = lookupTable[key.a].find(key);
+		assert(mdd != lookupTable[key.a].end());
+		memory_usage -= mdd->second.bytes;
+		mdd->second.mdd->clear();
+		delete mdd->second.mdd;
+		lookupTable[key.a].erase(mdd);
+		lru_list.pop_back();
+		num_released_mdds++;
 	}
-	cout << "\nFinished releasing MDD memory";
 }
 
 void MDDTable::clear()
@@ -700,10 +942,13 @@ void MDDTable::clear()
 	{
 		for (auto mdd : mdds)
 		{
-			delete mdd.second;
+			mdd.second.mdd->clear();
+			delete mdd.second.mdd;
 		}
 	}
 	lookupTable.clear();
+	lru_list.clear();
+	memory_usage = 0;
 }
 
 unordered_map<int, MDDNode*> collectMDDlevel(MDD* mdd, int i){
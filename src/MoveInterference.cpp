@@ -0,0 +1,132 @@
+#include "MoveInterference.h"
+#include "Instance.h"
+
+
+MoveInterference::Table::Table() : moves(STEPS * STEPS)
+{
+	// enumerate the primitives and sample their curves (relative to the start cell)
+	struct Primitive
+	{
+		int step_row, step_col;
+		vector<pair<double, double> > curve;
+	};
+	vector<Primitive> primitives(STEPS * STEPS); // the displacements have no curve, except for the wait
+	primitives[getStepId(0, 0)].curve.assign(SAMPLES - 1, make_pair(0.0, 0.0));
+	for (int r = -MAX_STEP; r <= MAX_STEP; r++)
+	for (int c = -MAX_STEP; c <= MAX_STEP; c++)
+	{
+		primitives[getStepId(r, c)].step_row = r;
+		primitives[getStepId(r, c)].step_col = c;
+	}
+	ids.resize(STEPS * STEPS * NUM_HEADINGS * NUM_HEADINGS);
+	for (int i = 0; i < (int)ids.size(); i++)
+		ids[i] = i / (NUM_HEADINGS * NUM_HEADINGS);
+	for (int h = 0; h < NUM_HEADINGS; h++)
+	{
+		double theta = h * D_THETA / 2;
+		int row_step, col_step;
+		double angle;
+		bool reverse;
+		for (const auto& motion : Instance::getMotions(theta))
+		{
+			tie(row_step, col_step, angle, reverse) = motion;
+			assert(abs(row_step) <= MAX_STEP && abs(col_step) <= MAX_STEP);
+			Primitive primitive;
+			primitive.step_row = row_step;
+			primitive.step_col = col_step;
+			for (int k = 1; k < SAMPLES; k++)
+				primitive.curve.push_back(Instance::getBezierPoint(0, 0, theta, row_step, col_step, angle, reverse,
+					(double)k / SAMPLES));
+			ids[(getStepId(row_step, col_step) * NUM_HEADINGS + h) * NUM_HEADINGS + HEADING_INDEX(angle)] =
+				(int)primitives.size();
+			primitives.push_back(primitive);
+		}
+	}
+	num_of_ids = (int)primitives.size();
+
+	// a displacement interferes wherever one of its primitives does
+	interfere.assign(num_of_ids * OFFSETS * OFFSETS * num_of_ids, false);
+	auto set = [&](int id1, int offset_row, int offset_col, int id2)
+	{
+		interfere[(id1 * OFFSETS * OFFSETS + getOffsetId(offset_row, offset_col)) * num_of_ids + id2] = true;
+	};
+	const double min_distance = 2 * AGENT_RADIUS;
+	for (int id1 = 0; id1 < num_of_ids; id1++)
+	for (int id2 = 0; id2 < num_of_ids; id2++)
+	{
+		const auto& p1 = primitives[id1];
+		const auto& p2 = primitives[id2];
+		if (p1.curve.empty() || p2.curve.empty())
+			continue;
+		int u1 = getStepId(p1.step_row, p1.step_col), u2 = getStepId(p2.step_row, p2.step_col);
+		for (int or_ = -MAX_OFFSET; or_ <= MAX_OFFSET; or_++)
+		for (int oc = -MAX_OFFSET; oc <= MAX_OFFSET; oc++)
+		{
+			if ((or_ == 0 && oc == 0) || // the same start cell
+				(or_ + p2.step_row == p1.step_row && oc + p2.step_col == p1.step_col)) // the same end cell
+				continue;
+			bool overlap = false;
+			for (int k = 0; k < SAMPLES - 1 && !overlap; k++)
+			{
+				double dr = or_ + p2.curve[k].first - p1.curve[k].first;
+				double dc = oc + p2.curve[k].second - p1.curve[k].second;
+				overlap = dr * dr + dc * dc < min_distance * min_distance;
+			}
+			if (!overlap)
+				continue;
+			assert(abs(or_) < MAX_OFFSET && abs(oc) < MAX_OFFSET);
+			assert(u1 != getStepId(0, 0) && u2 != getStepId(0, 0)); // PBS and insert2CT do not reserve the waits
+			if (!interfere[(u1 * OFFSETS * OFFSETS + getOffsetId(or_, oc)) * num_of_ids + u2])
+				moves[u1].push_back({ or_, oc, p2.step_row, p2.step_col });
+			set(id1, or_, oc, id2);
+			set(u1, or_, oc, id2);
+			set(id1, or_, oc, u2);
+			set(u1, or_, oc, u2);
+		}
+	}
+}
+
+const MoveInterference::Table& MoveInterference::getTable()
+{
+	static const Table table;
+	return table;
+}
+
+int MoveInterference::getPrimitiveId(const PathEntry& from, const PathEntry& to, int num_of_cols)
+{
+	int r = to.location / num_of_cols - from.location / num_of_cols;
+	int c = to.location % num_of_cols - from.location % num_of_cols;
+	assert(abs(r) <= MAX_STEP && abs(c) <= MAX_STEP);
+	int step = getStepId(r, c);
+	if (from.theta < 0 || to.theta < 0) // unknown headings
+		return step;
+	return getTable().ids[(step * NUM_HEADINGS + HEADING_INDEX(from.theta)) * NUM_HEADINGS + HEADING_INDEX(to.theta)];
+}
+
+bool MoveInterference::lookUp(int id1, int from1, int id2, int from2, int num_of_cols)
+{
+	int or_ = from2 / num_of_cols - from1 / num_of_cols, oc = from2 % num_of_cols - from1 % num_of_cols;
+	if (abs(or_) > MAX_OFFSET || abs(oc) > MAX_OFFSET)
+		return false;
+	const auto& table = getTable();
+	return table.interfere[(id1 * OFFSETS * OFFSETS + getOffsetId(or_, oc)) * table.num_of_ids + id2];
+}
+
+bool MoveInterference::interfere(const PathEntry& from1, const PathEntry& to1, const PathEntry& from2,
+	const PathEntry& to2, int num_of_cols)
+{
+	return lookUp(getPrimitiveId(from1, to1, num_of_cols), from1.location,
+		getPrimitiveId(from2, to2, num_of_cols), from2.location, num_of_cols);
+}
+
+bool MoveInterference::interfere(int from1, int to1, int from2, int to2, int num_of_cols)
+{
+	return interfere(PathEntry(from1), PathEntry(to1), PathEntry(from2), PathEntry(to2), num_of_cols);
+}
+
+const vector<MoveInterference::Move>& MoveInterference::getInterferingMoves(int from, int to, int num_of_cols)
+{
+	int r = to / num_of_cols - from / num_of_cols, c = to % num_of_cols - from % num_of_cols;
+	assert(abs(r) <= MAX_STEP && abs(c) <= MAX_STEP);
+	return getTable().moves[getStepId(r, c)];
+}
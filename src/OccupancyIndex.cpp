@@ -0,0 +1,112 @@
+#include "OccupancyIndex.h"
+#include "MoveInterference.h"
+#include <algorithm>
+
+
+void OccupancyIndex::reset(int map_size, int num_of_cols)
+{
+	this->num_of_cols = num_of_cols;
+	indexed.clear();
+	locations.clear();
+	visits.assign(map_size, vector< pair<int, int> >());
+	goals.assign(map_size, vector< pair<int, int> >());
+}
+
+void OccupancyIndex::sync(const vector<Path*>& paths)
+{
+	if (indexed.size() < paths.size())
+	{
+		indexed.resize(paths.size(), nullptr);
+		locations.resize(paths.size());
+	}
+	for (int a = 0; a < (int)paths.size(); a++)
+	{
+		if (indexed[a] == paths[a] && paths[a] != nullptr)
+			continue;
+		remove(a);
+		if (paths[a] != nullptr && !paths[a]->empty())
+			add(a, *paths[a]);
+		indexed[a] = paths[a];
+	}
+}
+
+void OccupancyIndex::add(int agent, const Path& path)
+{
+	auto& locs = locations[agent];
+	locs.resize(path.size());
+	for (int t = 0; t < (int)path.size(); t++)
+	{
+		locs[t] = path[t].location;
+		auto& cell = visits[locs[t]];
+		pair<int, int> entry(t, agent);
+		cell.insert(std::upper_bound(cell.begin(), cell.end(), entry), entry);
+	}
+	goals[locs.back()].emplace_back((int)locs.size() - 1, agent);
+}
+
+void OccupancyIndex::remove(int agent)
+{
+	auto& locs = locations[agent];
+	if (locs.empty())
+		return;
+	for (int t = 0; t < (int)locs.size(); t++)
+	{
+		auto& cell = visits[locs[t]];
+		auto it = std::lower_bound(cell.begin(), cell.end(), make_pair(t, agent));
+		assert(it != cell.end() && *it == make_pair(t, agent));
+		cell.erase(it);
+	}
+	auto& goal = goals[locs.back()];
+	goal.erase(std::find(goal.begin(), goal.end(), make_pair((int)locs.size() - 1, agent)));
+	locs.clear();
+}
+
+void OccupancyIndex::getVisitsAt(int loc, int timestep, vector<int>& agents) const
+{
+	const auto& cell = visits[loc];
+	for (auto it = std::lower_bound(cell.begin(), cell.end(), make_pair(timestep, -1));
+		 it != cell.end() && it->first == timestep; ++it)
+		agents.push_back(it->second);
+}
+
+void OccupancyIndex::getAgentsAt(int loc, int timestep, vector<int>& agents) const
+{
+	getVisitsAt(loc, timestep, agents);
+	for (const auto& goal : goals[loc])
+	{
+		if (goal.first < timestep)
+			agents.push_back(goal.second);
+	}
+}
+
+void OccupancyIndex::getAgentsVisiting(int loc, int from_timestep, vector<int>& agents) const
+{
+	const auto& cell = visits[loc];
+	for (auto it = std::lower_bound(cell.begin(), cell.end(), make_pair(from_timestep, -1)); it != cell.end(); ++it)
+		agents.push_back(it->second);
+}
+
+void OccupancyIndex::getCandidates(const Path& path, vector<int>& agents) const
+{
+	agents.clear();
+	int num_of_rows = (int)visits.size() / num_of_cols;
+	for (int t = 0; t < (int)path.size(); t++)
+	{
+		int loc = path[t].location;
+		getAgentsAt(loc, t, agents); // vertex and target conflicts
+		if (t + 1 == (int)path.size())
+			break;
+		int next = path[t + 1].location;
+		getVisitsAt(next, t, agents); // edge conflicts
+		for (const auto& move : MoveInterference::getInterferingMoves(loc, next, num_of_cols)) // crossings
+		{
+			int row = loc / num_of_cols + move.offset_row, col = loc % num_of_cols + move.offset_col;
+			if (0 <= row && row < num_of_rows && 0 <= col && col < num_of_cols)
+				getVisitsAt(row * num_of_cols + col, t, agents);
+		}
+	}
+	if (!path.empty()) // the agents passing the goal after the path ends
+		getAgentsVisiting(path.back().location, (int)path.size(), agents);
+	std::sort(agents.begin(), agents.end());
+	agents.erase(std::unique(agents.begin(), agents.end()), agents.end());
+}
@@ -0,0 +1,344 @@
+#include "PBS.h"
+#include "SpaceTimeAStar.h"
+#include "SIPP.h"
+#include "MoveInterference.h"
+
+
+PBS::PBS(const Instance& instance, bool sipp, int screen) :
+	instance(instance), screen(screen), num_of_agents(instance.getDefaultNumberOfAgents())
+{
+	search_engines.resize(num_of_agents);
+	for (int i = 0; i < num_of_agents; i++)
+	{
+		if (sipp)
+			search_engines[i] = new SIPP(instance, i);
+		else
+			search_engines[i] = new SpaceTimeAStar(instance, i);
+	}
+}
+
+PBS::~PBS()
+{
+	releaseNodes();
+	for (auto engine : search_engines)
+		delete engine;
+}
+
+bool PBS::solve(double _time_limit)
+{
+	time_limit = _time_limit;
+	start = std::chrono::steady_clock::now();
+	if (!generateRoot())
+	{
+		runtime = getRuntime();
+		if (screen > 0)
+			printResults();
+		return false;
+	}
+	while (!open_list.empty() && getRuntime() < time_limit)
+	{
+		auto curr = open_list.back();
+		open_list.pop_back();
+		updatePaths(curr);
+		if (curr->conflicts.empty())
+		{
+			solution_found = true;
+			solution_cost = curr->cost;
+			break;
+		}
+		num_HL_expanded++;
+		const auto& conflict = curr->conflicts.front();
+		PBSNode* children[2] = { new PBSNode(curr, conflict.first, conflict.second),
+			new PBSNode(curr, conflict.second, conflict.first) };
+		bool succeeded[2];
+		for (int i = 0; i < 2; i++)
+			succeeded[i] = generateChild(children[i]);
+		// depth-first, so the cheaper child is pushed last to be expanded next
+		if (succeeded[0] && succeeded[1] && children[0]->cost < children[1]->cost)
+			std::swap(children[0], children[1]);
+		for (int i = 0; i < 2; i++)
+		{
+			if (succeeded[i])
+				pushNode(children[i]);
+			else
+				delete children[i];
+		}
+	}
+	runtime = getRuntime();
+	if (screen > 0)
+		printResults();
+	return solution_found;
+}
+
+bool PBS::generateRoot()
+{
+	auto root = new PBSNode();
+	paths.assign(num_of_agents, nullptr);
+	lower_agents.assign(num_of_agents, vector<int>());
+	occupancy.reset(instance.map_size, instance.num_of_cols);
+	set<int> agents;
+	for (int i = 0; i < num_of_agents; i++)
+	{
+		if (!replan(root, i, vector<int>()))
+		{
+			delete root;
+			return false;
+		}
+		agents.insert(i);
+	}
+	root_cost = root->cost;
+	findConflicts(root, agents);
+	num_root_conflicts = root->conflicts.size();
+	pushNode(root);
+	return true;
+}
+
+// The lower agent of the new priority pair is replanned, and so is every agent below it whose path then collides
+// with a path of higher priority, in topological order so that the agents above an agent are replanned before it.
+bool PBS::generateChild(PBSNode* child)
+{
+	int higher = child->priority.first, lower = child->priority.second;
+	if (isHigher(lower, higher)) // the pair would close a cycle
+	{
+		num_dead_ends++;
+		return false;
+	}
+	child->cost = child->parent->cost;
+	lower_agents[higher].push_back(lower);
+	list<int> order;
+	vector<bool> visited(num_of_agents, false);
+	topologicalSort(lower, visited, order);
+	set<int> replanned;
+	bool succeeded = true;
+	for (auto agent : order)
+	{
+		auto higher_agents = getHigherAgents(agent);
+		bool collided = agent == lower;
+		for (auto it = higher_agents.begin(); it != higher_agents.end() && !collided; ++it)
+			collided = collide(*paths[agent], *paths[*it]);
+		if (!collided)
+			continue;
+		if (!replan(child, agent, higher_agents))
+		{
+			succeeded = false;
+			break;
+		}
+		replanned.insert(agent);
+	}
+	if (succeeded)
+		findConflicts(child, replanned);
+	else
+		num_dead_ends++;
+	updatePaths(child->parent);
+	return succeeded;
+}
+
+void PBS::updatePaths(PBSNode* node)
+{
+	paths.assign(num_of_agents, nullptr);
+	lower_agents.assign(num_of_agents, vector<int>());
+	for (auto curr = node; curr != nullptr; curr = curr->parent)
+	{
+		for (auto& path : curr->paths)
+		{
+			if (paths[path.first] == nullptr)
+				paths[path.first] = &path.second;
+		}
+		if (curr->parent != nullptr)
+			lower_agents[curr->priority.first].push_back(curr->priority.second);
+	}
+}
+
+// the paths of the higher agents are reserved as hard constraints, and the other paths are avoided if possible
+bool PBS::replan(PBSNode* node, int agent, const vector<int>& higher)
+{
+	ConstraintTable reservations(instance.num_of_cols, instance.map_size);
+	for (auto a : higher)
+		reservations.insert2CT(*paths[a]);
+	CBSNode root{}; // value-initialized, so it has no parent and no constraints
+	auto path = search_engines[agent]->findOptimalPath(root, reservations, paths, agent, 0);
+	num_LL_expanded += search_engines[agent]->num_expanded;
+	num_LL_generated += search_engines[agent]->num_generated;
+	if (path.empty())
+		return false;
+	node->cost += (int)path.size() - 1;
+	if (paths[agent] != nullptr)
+		node->cost -= (int)paths[agent]->size() - 1;
+	node->paths.emplace_back(agent, path);
+	paths[agent] = &node->paths.back().second;
+	return true;
+}
+
+// the conflicts of the parent that are left, and those of the replanned agents
+void PBS::findConflicts(PBSNode* node, const set<int>& replanned)
+{
+	occupancy.sync(paths);
+	if (node->parent != nullptr)
+	{
+		for (const auto& conflict : node->parent->conflicts)
+		{
+			if (replanned.find(conflict.first) == replanned.end() && replanned.find(conflict.second) == replanned.end() &&
+				collide(conflict.first, conflict.second)) // the new priorities may have resolved it
+				node->conflicts.push_back(conflict);
+		}
+	}
+	vector<int> candidates;
+	for (auto a1 : replanned)
+	{
+		occupancy.getCandidates(*paths[a1], candidates);
+		for (auto a2 : candidates)
+		{
+			if (a1 == a2 || (a2 < a1 && replanned.find(a2) != replanned.end())) // the pair has been checked already
+				continue;
+			if (collide(a1, a2))
+				node->conflicts.emplace_back(min(a1, a2), max(a1, a2));
+		}
+	}
+}
+
+vector<int> PBS::getHigherAgents(int agent) const
+{
+	vector< vector<int> > higher_agents(num_of_agents);
+	for (int i = 0; i < num_of_agents; i++)
+	{
+		for (auto a : lower_agents[i])
+			higher_agents[a].push_back(i);
+	}
+	vector<int> rst;
+	vector<bool> visited(num_of_agents, false);
+	list<int> open{agent};
+	visited[agent] = true;
+	while (!open.empty())
+	{
+		int curr = open.front();
+		open.pop_front();
+		for (auto a : higher_agents[curr])
+		{
+			if (!visited[a])
+			{
+				visited[a] = true;
+				rst.push_back(a);
+				open.push_back(a);
+			}
+		}
+	}
+	return rst;
+}
+
+bool PBS::isHigher(int a1, int a2) const
+{
+	vector<bool> visited(num_of_agents, false);
+	list<int> open{a1};
+	visited[a1] = true;
+	while (!open.empty())
+	{
+		int curr = open.front();
+		open.pop_front();
+		for (auto a : lower_agents[curr])
+		{
+			if (a == a2)
+				return true;
+			if (!visited[a])
+			{
+				visited[a] = true;
+				open.push_back(a);
+			}
+		}
+	}
+	return false;
+}
+
+void PBS::topologicalSort(int agent, vector<bool>& visited, list<int>& order) const
+{
+	visited[agent] = true;
+	for (auto a : lower_agents[agent])
+	{
+		if (!visited[a])
+			topologicalSort(a, visited, order);
+	}
+	order.push_front(agent);
+}
+
+// Two agents without a priority between them collide if either path collides with the other one as a reserved path.
+bool PBS::collide(int a1, int a2) const
+{
+	if (isHigher(a1, a2))
+		return collide(*paths[a2], *paths[a1]);
+	if (isHigher(a2, a1))
+		return collide(*paths[a1], *paths[a2]);
+	return collide(*paths[a1], *paths[a2]) || collide(*paths[a2], *paths[a1]);
+}
+
+// whether the lower path violates the higher path reserved by ConstraintTable::insert2CT(const Path&): its locations
+// (the goal forever), and its moves, which block the moves and waits that interfere with them
+bool PBS::collide(const Path& lower, const Path& higher) const
+{
+	int lower_length = (int)lower.size(), higher_length = (int)higher.size();
+	for (int t = 1; t < max(lower_length, higher_length); t++)
+	{
+		int loc = lower[min(t, lower_length - 1)].location;
+		if (loc == higher[min(t, higher_length - 1)].location)
+			return true;
+		if (t < lower_length && t < higher_length && higher[t - 1].location != higher[t].location &&
+			MoveInterference::interfere(lower[t - 1], lower[t], higher[t - 1], higher[t],
+				instance.num_of_cols))
+			return true;
+	}
+	return false;
+}
+
+void PBS::pushNode(PBSNode* node)
+{
+	num_HL_generated++;
+	node->time_generated = num_HL_generated;
+	open_list.push_back(node);
+	allNodes_table.push_back(node);
+}
+
+void PBS::releaseNodes()
+{
+	open_list.clear();
+	for (auto node : allNodes_table)
+		delete node;
+	allNodes_table.clear();
+}
+
+void PBS::printResults() const
+{
+	cout << "PBS: " << (solution_found ? "Succeed" : (runtime >= time_limit ? "Timeout" : "Fail")) << ", cost " <<
+		solution_cost << " (root " << root_cost << ", " << num_root_conflicts << " root conflicts), runtime " << runtime <<
+		" s, " << num_HL_expanded << " expanded, " << num_HL_generated << " generated, " << num_dead_ends << " dead ends" << endl;
+}
+
+void PBS::saveResults(const string& fileName, const string& instanceName) const
+{
+	std::ifstream infile(fileName);
+	bool exist = infile.good();
+	infile.close();
+	if (!exist)
+	{
+		ofstream addHeads(fileName);
+		addHeads << "runtime,#high-level expanded,#high-level generated,#low-level expanded,#low-level generated," <<
+			"solution cost,root g value,#root conflicts,#dead ends,solver name,instance name" << endl;
+		addHeads.close();
+	}
+	ofstream stats(fileName, std::ios::app);
+	stats << runtime << "," << num_HL_expanded << "," << num_HL_generated << "," << num_LL_expanded << "," <<
+		num_LL_generated << "," << solution_cost << "," << root_cost << "," << num_root_conflicts << "," <<
+		num_dead_ends << "," << "PBS" << "," << instanceName << endl;
+	stats.close();
+}
+
+void PBS::savePaths(const string& fileName) const
+{
+	std::ofstream output(fileName, std::ios::out);
+	for (int i = 0; i < num_of_agents; i++)
+	{
+		output << "Agent " << i << ": ";
+		for (const auto& t : *paths[i])
+			output << "(" << instance.getRowCoordinate(t.location) << "," << instance.getColCoordinate(t.location) <<
+				"," << t.theta << ")->";
+		output << endl;
+	}
+	output.close();
+}
@@ -0,0 +1,203 @@
+#include "PrioritizedPlanning.h"
+#include "SpaceTimeAStar.h"
+#include "SIPP.h"
+#include <algorithm>
+#include <numeric>
+
+
+PrioritizedPlanning::PrioritizedPlanning(const CBS& heuristic_source, const Instance& instance, bool sipp, int screen,
+	int num_of_threads) :
+	heuristic_source(heuristic_source), instance(instance), sipp(sipp), screen(screen),
+	num_of_threads(max(1, num_of_threads)), num_of_agents(instance.getDefaultNumberOfAgents()) {}
+
+bool PrioritizedPlanning::solve(double _time_limit, int num_of_orders)
+{
+	time_limit = _time_limit;
+	start = std::chrono::steady_clock::now();
+	// every thread plans with its own search engines
+	vector< vector<SingleAgentSolver*> > search_engines(num_of_threads, vector<SingleAgentSolver*>(num_of_agents));
+	for (auto& engines : search_engines)
+	{
+		for (int i = 0; i < num_of_agents; i++)
+		{
+			if (sipp)
+				engines[i] = new SIPP(heuristic_source.getSearchEngine(i));
+			else
+				engines[i] = new SpaceTimeAStar(heuristic_source.getSearchEngine(i));
+		}
+	}
+
+	// the lower bounds on the costs of the shortest paths give the lower bound and the heuristic orders; they are
+	// those the low level returns, as the heuristic on the lattice can overestimate, so the paths may be longer
+	shortest_path_costs.assign(num_of_agents, 0);
+	vector<uint64_t> expanded(num_of_agents, 0), generated(num_of_agents, 0);
+	CBS::parallelFor(num_of_agents, num_of_threads, [&](size_t i)
+	{
+		CBSNode root{}; // value-initialized, so it has no parent and no constraints
+		ConstraintTable constraints(instance.num_of_cols, instance.map_size);
+		auto path = search_engines[0][i]->findSuboptimalPath(root, constraints, vector<Path*>(num_of_agents, nullptr), (int)i, 0, 1);
+		shortest_path_costs[i] = path.second;
+		expanded[i] = search_engines[0][i]->num_expanded;
+		generated[i] = search_engines[0][i]->num_generated;
+	});
+	lower_bound = std::accumulate(shortest_path_costs.begin(), shortest_path_costs.end(), 0);
+	num_LL_expanded = std::accumulate(expanded.begin(), expanded.end(), (uint64_t)0);
+	num_LL_generated = std::accumulate(generated.begin(), generated.end(), (uint64_t)0);
+
+	// The orders are striped over the threads. A plan that gets more expensive than the best one so far is given up,
+	// and of the plans with the same cost, the one of the first order is kept, so the result does not depend on
+	// the timing of the threads.
+	vector<int> costs(num_of_orders, -3); // not tried
+	vector<int> thread_best(num_of_threads, -1); // the best order of each thread
+	vector< vector<Path> > thread_paths(num_of_threads), thread_best_paths(num_of_threads);
+	vector<uint64_t> thread_expanded(num_of_threads, 0), thread_generated(num_of_threads, 0);
+	std::atomic<int> best_cost(MAX_COST);
+	std::atomic<int> tried(0);
+	CBS::parallelFor(num_of_threads, num_of_threads, [&](size_t thread)
+	{
+		for (int i = (int)thread; i < num_of_orders && getRuntime() < time_limit; i += num_of_threads)
+		{
+			tried++;
+			costs[i] = planInOrder(getOrder(i), search_engines[thread], thread_paths[thread], best_cost,
+				thread_expanded[thread], thread_generated[thread]);
+			if (costs[i] < 0)
+				continue;
+			int best = best_cost;
+			while (costs[i] < best && !best_cost.compare_exchange_weak(best, costs[i])) {}
+			if (thread_best[thread] < 0 || costs[i] < costs[thread_best[thread]])
+			{
+				thread_best[thread] = i;
+				thread_best_paths[thread].swap(thread_paths[thread]);
+			}
+		}
+	});
+	num_orders = tried;
+	for (int thread = 0; thread < num_of_threads; thread++)
+	{
+		num_LL_expanded += thread_expanded[thread];
+		num_LL_generated += thread_generated[thread];
+		int i = thread_best[thread];
+		if (i >= 0 && (best_order < 0 || costs[i] < costs[best_order] || (costs[i] == costs[best_order] && i < best_order)))
+			best_order = i;
+	}
+	num_failed_orders = std::count(costs.begin(), costs.end(), -1);
+	solution_found = best_order >= 0;
+	if (solution_found)
+	{
+		solution_cost = costs[best_order];
+		paths.swap(thread_best_paths[best_order % num_of_threads]);
+	}
+
+	for (auto& engines : search_engines)
+	{
+		for (auto engine : engines)
+			delete engine;
+	}
+	runtime = getRuntime();
+	if (screen > 0)
+		printResults();
+	return solution_found;
+}
+
+// Order 0 plans the agents with the longest shortest paths first, as they have the fewest detours to spare,
+// order 1 the shortest first, and the others are random permutations seeded by their index.
+vector<int> PrioritizedPlanning::getOrder(int order) const
+{
+	vector<int> agents(num_of_agents);
+	std::iota(agents.begin(), agents.end(), 0);
+	if (order == 0)
+	{
+		std::stable_sort(agents.begin(), agents.end(),
+			[&](int a1, int a2) { return shortest_path_costs[a1] > shortest_path_costs[a2]; });
+	}
+	else if (order == 1)
+	{
+		std::stable_sort(agents.begin(), agents.end(),
+			[&](int a1, int a2) { return shortest_path_costs[a1] < shortest_path_costs[a2]; });
+	}
+	else
+	{
+		std::mt19937 rng(order);
+		std::shuffle(agents.begin(), agents.end(), rng);
+	}
+	return agents;
+}
+
+int PrioritizedPlanning::planInOrder(const vector<int>& order, vector<SingleAgentSolver*>& search_engines,
+	vector<Path>& order_paths, const std::atomic<int>& best_cost, uint64_t& expanded, uint64_t& generated) const
+{
+	CBSNode root{};
+	ConstraintTable reservations(instance.num_of_cols, instance.map_size); // the paths planned so far
+	vector<Path*> no_paths(num_of_agents, nullptr);
+	order_paths.assign(num_of_agents, Path());
+	int cost = 0;
+	for (auto ag : order)
+	{
+		if (getRuntime() >= time_limit)
+			return -1;
+		order_paths[ag] = search_engines[ag]->findOptimalPath(root, reservations, no_paths, ag, shortest_path_costs[ag]);
+		expanded += search_engines[ag]->num_expanded;
+		generated += search_engines[ag]->num_generated;
+		if (order_paths[ag].empty())
+			return -1;
+		cost += (int)order_paths[ag].size() - 1;
+		if (cost > best_cost)
+			return -2;
+		reservations.insert2CT(order_paths[ag]);
+	}
+	return cost;
+}
+
+string PrioritizedPlanning::getOrderName(int order)
+{
+	switch (order)
+	{
+	case -1:
+		return "none";
+	case 0:
+		return "longest first";
+	case 1:
+		return "shortest first";
+	default:
+		return "random " + std::to_string(order);
+	}
+}
+
+void PrioritizedPlanning::printResults() const
+{
+	cout << "Prioritized planning: " << (solution_found ? "Succeed" : "Fail") << ", cost " << solution_cost <<
+		" (lower bound " << lower_bound << "), runtime " << runtime << " s, " << num_orders << " orders (" <<
+		num_failed_orders << " failed), best order " << getOrderName(best_order) << endl;
+}
+
+void PrioritizedPlanning::saveResults(const string& fileName, const string& instanceName) const
+{
+	std::ifstream infile(fileName);
+	bool exist = infile.good();
+	infile.close();
+	if (!exist)
+	{
+		ofstream addHeads(fileName);
+		addHeads << "runtime,solution cost,lower bound,#orders,#failed orders,best order," <<
+			"#low-level expanded,#low-level generated,instance name" << endl;
+		addHeads.close();
+	}
+	ofstream stats(fileName, std::ios::app);
+	stats << runtime << "," << solution_cost << "," << lower_bound << "," << num_orders << "," << num_failed_orders << "," <<
+		getOrderName(best_order) << "," << num_LL_expanded << "," << num_LL_generated << "," << instanceName << endl;
+	stats.close();
+}
+
+void PrioritizedPlanning::savePaths(const string& fileName) const
+{
+	std::ofstream output(fileName, std::ios::out);
+	for (int i = 0; i < num_of_agents; i++)
+	{
+		output << "Agent " << i << ": ";
+		for (const auto& t : paths[i])
+			output << "(" << instance.getRowCoordinate(t.location) << "," << instance.getColCoordinate(t.location) <<
+				"," << t.theta << ")->";
+		output << endl;
+	}
+	output.close();
+}
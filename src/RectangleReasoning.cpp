@@ -558,8 +558,7 @@ list<int> RectangleReasoning::getStartCandidates(const Path& path, const MDD& md
 	list<int> starts;
 	for (int t = 0; t <= timestep; t++) //Find start that is single and Manhattan-optimal to conflicting location
 	{
-		if (mdd.levels[t].size() == 1 &&
-			mdd.levels[t].front()->location == path[t].location &&
+		if (mdd.isSingleton(t, path[t].location) &&
 			instance.getManhattanDistance(path[t].location, path[timestep].location) == timestep - t)
 			starts.push_back(t);
 	}
@@ -572,8 +571,7 @@ list<int> RectangleReasoning::getGoalCandidates(const Path& path, const MDD& mdd
 	list<int> goals;
 	for (int t = (int) path.size() - 1; t >= timestep; t--) //Find end that is single and Manhattan-optimal to conflicting location
 	{
-		if (mdd.levels[t].size() == 1 &&
-			mdd.levels[t].front()->location == path[t].location &&
+		if (mdd.isSingleton(t, path[t].location) &&
 			instance.getManhattanDistance(path[t].location, path[timestep].location) == t - timestep)
 			goals.push_back(t);
 	}
@@ -738,13 +736,8 @@ bool RectangleReasoning::hasNodeOnBarrier(const MDD* mdd, int y_start, int y_end
 			loc = instance.linearizeCoordinate(x, y_start + (t2 - t_min) * sign);
 		else
 			loc = instance.linearizeCoordinate(y_start + (t2 - t_min) * sign, x);
-		for (MDDNode* n : mdd->levels[t2])
-		{
-			if (n->location == loc)
-			{
-				return true;
-			}
-		}
+		if (mdd->hasCell(t2, loc))
+			return true;
 	}
 	return false;
 }
@@ -170,7 +170,9 @@ pair<Path, int> SIPP::findSuboptimalPath(const HLNode& node, const ConstraintTab
     // generate start and add it to the OPEN list
     auto start = new SIPPNode(start_location, 0, max(my_heuristic[start_location], holding_time), nullptr, 0,
                               get<1>(interval), get<1>(interval), get<2>(interval), get<2>(interval));
-    min_f_val = max(holding_time, max((int)start->getFVal(), lowerbound));
+    // the heuristic is not 0 at the goal, so the f-values are the path lengths plus my_heuristic[goal_location];
+    // min_f_val stays non-negative, as FOCAL is bounded by w * min_f_val
+    min_f_val = max(max(max(holding_time, lowerbound) + my_heuristic[goal_location], (int)start->getFVal()), 0);
     pushNodeToOpenAndFocal(start);
 
     while (!open_list.empty())
@@ -238,7 +240,11 @@ pair<Path, int> SIPP::findSuboptimalPath(const HLNode& node, const ConstraintTab
 
     // no path found
     releaseNodes();
-    return {path, min_f_val};
+    // the lower bound on the path length, which the path itself bounds as the heuristic on the lattice can overestimate
+    int lowerbound_found = min_f_val - my_heuristic[goal_location];
+    if (!path.empty())
+        lowerbound_found = min(lowerbound_found, (int)path.size() - 1);
+    return {path, lowerbound_found};
 }
 /*Path SIPP::findNoCollisionPath(const ConstraintTable& constraint_table)
 {
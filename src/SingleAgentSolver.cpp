@@ -15,6 +15,19 @@ list<pair<int,double>> SingleAgentSolver::getNextLocations(int curr,double theta
 	return rst;	
 }
 
+void SingleAgentSolver::setTask(int start, double theta, int goal, const vector<int>* heuristic)
+{
+	start_location = start;
+	start_theta = theta;
+	if (goal == goal_location)
+		return;
+	goal_location = goal;
+	if (heuristic != nullptr)
+		my_heuristic = *heuristic;
+	else
+		compute_heuristics();
+}
+
 void SingleAgentSolver::compute_heuristics()
 {
 	struct Node
@@ -37,7 +50,7 @@ void SingleAgentSolver::compute_heuristics()
 		};  // used by OPEN (heap) to compare nodes (top of the heap has min f-val, and then highest g-val)
 	};
 
-	my_heuristic.resize(instance.map_size, MAX_TIMESTEP);
+	my_heuristic.assign(instance.map_size, MAX_TIMESTEP);
 
 	// generate a heap that can save nodes (and an open_handle)
 	boost::heap::pairing_heap< Node, boost::heap::compare<Node::compare_node> > heap;
@@ -84,7 +84,9 @@ pair<Path, int> SpaceTimeAStar::findSuboptimalPath(const HLNode& node, const Con
     // the earliest timestep that the agent can hold its goal location. The length_min is considered here.
     auto holding_time = constraint_table.getHoldingTime(goal_location, constraint_table.length_min);
     auto static_timestep = constraint_table.getMaxTimestep() + 1; // everything is static after this timestep
-    lowerbound =  max(holding_time, lowerbound);
+    // the heuristic is not 0 at the goal, so the f-values are the path lengths plus my_heuristic[goal_location];
+    // min_f_val stays non-negative, as FOCAL is bounded by w * min_f_val
+    lowerbound =  max(max(holding_time, lowerbound) + my_heuristic[goal_location], 0);
 
     // generate start and add it to the OPEN & FOCAL list
     // AStarNode* start;
@@ -94,7 +96,7 @@ pair<Path, int> SpaceTimeAStar::findSuboptimalPath(const HLNode& node, const Con
     // else{
     //     start = new AStarNode(start_location, 0, 0, max(lowerbound, my_heuristic[start_location]), nullptr, 0, 0);
     // }
-    auto start = new AStarNode(start_location, 0, 0, max(lowerbound, my_heuristic[start_location]), nullptr, 0, 0);
+    auto start = new AStarNode(start_location, start_theta, 0, max(lowerbound, my_heuristic[start_location]), nullptr, 0, 0);
 
     num_generated++;
     start->open_handle = open_list.push(start);
@@ -243,7 +245,11 @@ pair<Path, int> SpaceTimeAStar::findSuboptimalPath(const HLNode& node, const Con
     for(auto p:path){
         cout << "\n" << p.location << ":" << p.theta << endl;
     }
-    return {path, min_f_val};
+    // the lower bound on the path length, which the path itself bounds as the heuristic on the lattice can overestimate
+    int lowerbound_found = min_f_val - my_heuristic[goal_location];
+    if (!path.empty())
+        lowerbound_found = min(lowerbound_found, (int)path.size() - 1);
+    return {path, lowerbound_found};
 }
 
 
@@ -253,11 +259,13 @@ int SpaceTimeAStar::getTravelTime(int start, int end, const ConstraintTable& con
     auto static_timestep = constraint_table.getMaxTimestep() + 1; // everything is static after this timestep
     auto root = new AStarNode(start, 0, compute_heuristic(start, end), nullptr, 0, 0);
     root->open_handle = open_list.push(root);  // add root to heap
+    root->in_openlist = true;
     allNodes_table.insert(root);       // add root to hash_table (nodes)
     AStarNode* curr = nullptr;
     while (!open_list.empty())
     {
         curr = open_list.top(); open_list.pop();
+        curr->in_openlist = false;
         if (curr->location == end)
         {
             length = curr->g_val;
@@ -289,6 +297,7 @@ int SpaceTimeAStar::getTravelTime(int start, int end, const ConstraintTable& con
                 if (it == allNodes_table.end())
                 {  // add the newly generated node to heap and hash table
                     next->open_handle = open_list.push(next);
+                    next->in_openlist = true;
                     allNodes_table.insert(next);
                 }
                 else {  // update existing node's g_val if needed (only in the heap)
@@ -298,7 +307,13 @@ int SpaceTimeAStar::getTravelTime(int start, int end, const ConstraintTable& con
                     {
                         existing_next->g_val = next_g_val;
                         existing_next->timestep = next_timestep;
-                        open_list.increase(existing_next->open_handle);
+                        if (existing_next->in_openlist)
+                            open_list.increase(existing_next->open_handle);
+                        else // the heuristic on the lattice can overestimate, so an expanded node may be reached sooner
+                        {
+                            existing_next->open_handle = open_list.push(existing_next);
+                            existing_next->in_openlist = true;
+                        }
                     }
                 }
             }
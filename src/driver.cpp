@@ -9,7 +9,54 @@
 */
 #include <boost/program_options.hpp>
 #include <boost/tokenizer.hpp>
+#include <thread>
 #include "ECBS.h"
+#include "Lifelong.h"
+#include "IndependenceDetection.h"
+#include "PrioritizedPlanning.h"
+#include "LNS.h"
+#include "PBS.h"
+
+
+// a configuration raced by --portfolio
+struct PortfolioMember
+{
+	high_level_solver_type solver;
+	heuristics_type h_hat;
+	bool bypass;
+	bool random_root;
+	int seed;
+	string name;
+};
+
+// member i varies the given configuration, and members beyond the variants repeat them with random roots
+vector<PortfolioMember> getPortfolio(int size, high_level_solver_type s, heuristics_type h_hat, bool bypass)
+{
+	PortfolioMember given = { s, h_hat, bypass, false, 0, "given" };
+	vector<PortfolioMember> variants(5, given);
+	variants[1].bypass = !bypass;
+	variants[1].name = bypass ? "no bypass" : "bypass";
+	variants[2].solver = (s == high_level_solver_type::EES) ? high_level_solver_type::NEW : high_level_solver_type::EES;
+	variants[2].name = (s == high_level_solver_type::EES) ? "NEW" : "EES";
+	if (variants[2].h_hat == heuristics_type::ZERO)
+		variants[2].h_hat = heuristics_type::GLOBAL;
+	variants[3].h_hat = heuristics_type::PATH;
+	variants[3].name = "Path h";
+	variants[4].h_hat = heuristics_type::LOCAL;
+	variants[4].name = "Local h";
+	vector<PortfolioMember> portfolio;
+	for (int i = 0; i < size; i++)
+	{
+		portfolio.push_back(variants[i % variants.size()]);
+		if (i >= (int)variants.size())
+		{
+			portfolio.back().random_root = true;
+			portfolio.back().seed = i;
+			portfolio.back().name += " random root seed " + std::to_string(i);
+		}
+	}
+	return portfolio;
+}
 
 
 /* Main function */
@@ -32,7 +79,7 @@ int main(int argc, char** argv)
 		("stats", po::value<bool>()->default_value(false), "write to files some detailed statistics")
 
 		// params for CBS node selection strategies
-		("highLevelSolver", po::value<string>()->default_value("EES"), "the high-level solver (A*, A*eps, EES, NEW)")
+		("highLevelSolver", po::value<string>()->default_value("EES"), "the high-level solver (A*, A*eps, EES, NEW, or PBS: priority-based search)")
 		("lowLevelSolver", po::value<bool>()->default_value(true), "using suboptimal solver in the low level")
 		("inadmissibleH", po::value<string>()->default_value("Global"), "inadmissible heuristics (Zero, Global, Path, Local, Conflict)")
 		("suboptimality", po::value<double>()->default_value(1.2), "suboptimality bound")
@@ -47,6 +94,29 @@ int main(int argc, char** argv)
 		("targetReasoning", po::value<bool>()->default_value(true), "target reasoning")
 		("sipp", po::value<bool>()->default_value(0), "using SIPPS as the low-level solver")
 		("restart", po::value<int>()->default_value(0), "rapid random restart times")
+		("portfolio", po::value<int>()->default_value(0), "number of ECBS configurations raced in parallel threads (0: off)")
+		("threads", po::value<int>()->default_value(1), "number of threads (>1: replan the two children of a CT node and the agents of each child in parallel)")
+		("parallelRoot", po::value<bool>()->default_value(false), "plan the root of ECBS in parallel waves of agents with disjoint corridors, shortest first")
+		("expansionBatch", po::value<int>()->default_value(1), "number of CT nodes expanded together in ECBS (>1: the low-level searches of their children run on --threads threads; the selection, conflict classification, heuristics and bypasses stay serial)")
+		("mdd-memory-mb", po::value<int>()->default_value(1024), "memory budget for the MDD cache (MB)")
+		("hl-memory-mb", po::value<int>()->default_value(0), "memory budget for the CT nodes and their paths in ECBS (MB; 0: no limit)")
+		("anytime", po::value<bool>()->default_value(false), "keep improving the ECBS solution until the cutoff time, writing each one to --outputPaths and --output")
+		("bestEffort", po::value<bool>()->default_value(false), "if ECBS finds no solution by the cutoff time, return the plan with the fewest conflicts (raising the suboptimality when behind schedule)")
+		("checkpoint", po::value<string>(), "log file to checkpoint the ECBS search to")
+		("checkpoint-interval", po::value<double>()->default_value(60), "seconds between two ECBS checkpoints")
+		("resume", po::value<bool>()->default_value(false), "continue the ECBS search from the last checkpoint in --checkpoint (from the root if there is none)")
+		("window", po::value<int>()->default_value(0), "only resolve the conflicts before this timestep, planning complete paths, in lifelong mode (0: all conflicts)")
+		("mergeThreshold", po::value<int>()->default_value(0), "merge two agents (or meta-agents) of ECBS into one planned jointly once they conflict more often than this along a CT branch (0: never)")
+		("prioritizedPlanning", po::value<int>()->default_value(0), "number of priority orders prioritized planning tries first, on --threads threads; its plan is returned if it is within the suboptimality bound, and otherwise bounds the cost for ECBS (0: off)")
+		("lns", po::value<double>()->default_value(0), "seconds large neighborhood search spends improving the plan of ECBS or prioritized planning, whose paths it writes to --outputPaths instead (0: off)")
+		("lnsNeighborSize", po::value<int>()->default_value(8), "number of agents replanned in each iteration of large neighborhood search")
+		("lnsReplan", po::value<string>()->default_value("CBS"), "how large neighborhood search replans a neighborhood (CBS: CBS over its agents, PP: prioritized planning in a random order)")
+		("lnsTrace", po::value<string>(), "output file for the sum of costs of large neighborhood search over time")
+		("independenceDetection", po::value<bool>()->default_value(false), "split the agents into groups with conflict-free paths, each solved by its own ECBS, on --threads threads")
+		("goals", po::value<string>(), "input file for the goals each agent visits after its first one (lifelong mode, replanning with ECBS)")
+		("replanInterval", po::value<int>()->default_value(5), "timesteps executed between two replans in lifelong mode")
+		("heuristic-cache-mb", po::value<int>()->default_value(256), "memory budget for the heuristic tables of past goals in lifelong mode (MB)")
+		("simulationTime", po::value<int>()->default_value(100), "timesteps simulated in lifelong mode (--cutoffTime is the limit of each replan)")
 		;
 	po::variables_map vm;
 	po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -62,8 +132,93 @@ int main(int argc, char** argv)
 		cerr << "Suboptimal bound should be at least 1!" << endl;
 		return -1;
 	}
+	if (vm["mdd-memory-mb"].as<int>() < 0)
+	{
+		cerr << "The memory budget for the MDD cache should be at least 0!" << endl;
+		return -1;
+	}
+	if (vm["hl-memory-mb"].as<int>() < 0)
+	{
+		cerr << "The memory budget for the CT nodes should be at least 0!" << endl;
+		return -1;
+	}
+	if (vm["heuristic-cache-mb"].as<int>() < 0)
+	{
+		cerr << "The memory budget for the heuristic tables should be at least 0!" << endl;
+		return -1;
+	}
+
+	if (vm["resume"].as<bool>() && !vm.count("checkpoint"))
+	{
+		cerr << "--resume needs --checkpoint!" << endl;
+		return -1;
+	}
+	if (vm.count("checkpoint") && (vm["anytime"].as<bool>() || vm["restart"].as<int>() > 0 || vm["portfolio"].as<int>() > 0))
+	{
+		cerr << "Checkpoints cannot be combined with --anytime, --restart or --portfolio!" << endl;
+		return -1;
+	}
+	if (vm["mergeThreshold"].as<int>() > 0 && (vm["expansionBatch"].as<int>() > 1 || vm.count("checkpoint")))
+	{
+		cerr << "Merging cannot be combined with --expansionBatch or --checkpoint!" << endl;
+		return -1;
+	}
+	if (vm["hl-memory-mb"].as<int>() > 0 && (vm["anytime"].as<bool>() || vm["bestEffort"].as<bool>() ||
+		vm["mergeThreshold"].as<int>() > 0))
+	{
+		cerr << "Retired CT nodes are regenerated as they were, so --hl-memory-mb cannot be combined with --anytime, --bestEffort or --mergeThreshold!" << endl;
+		return -1;
+	}
+	if (vm["independenceDetection"].as<bool>() && (!vm["lowLevelSolver"].as<bool>() || vm["anytime"].as<bool>() ||
+		vm["bestEffort"].as<bool>() || vm["portfolio"].as<int>() > 0 || vm.count("checkpoint") || vm.count("goals")))
+	{
+		cerr << "Independence detection runs ECBS without --anytime, --bestEffort, --portfolio, --checkpoint or --goals!" << endl;
+		return -1;
+	}
+	if (vm["window"].as<int>() > 0 && !vm.count("goals"))
+	{
+		cerr << "--window needs --goals: only the lifelong mode resolves the collisions after the window, in its next replans!" << endl;
+		return -1;
+	}
+	if (vm.count("goals") && vm["window"].as<int>() > 0 && vm["window"].as<int>() < vm["replanInterval"].as<int>())
+	{
+		cerr << "The window should cover the --replanInterval timesteps that are executed!" << endl;
+		return -1;
+	}
+	if (vm.count("goals") && (!vm["lowLevelSolver"].as<bool>() || vm["anytime"].as<bool>() ||
+		vm["portfolio"].as<int>() > 0 || vm.count("checkpoint")))
+	{
+		cerr << "The lifelong mode replans with a single ECBS solver, without --anytime, --portfolio or --checkpoint!" << endl;
+		return -1;
+	}
 
-	high_level_solver_type s;
+	if (vm["prioritizedPlanning"].as<int>() > 0 && (!vm["lowLevelSolver"].as<bool>() || vm["portfolio"].as<int>() > 0 ||
+		vm["independenceDetection"].as<bool>() || vm.count("goals")))
+	{
+		cerr << "Prioritized planning runs before a single ECBS solver, without --portfolio, --independenceDetection or --goals!" << endl;
+		return -1;
+	}
+	if (vm["lns"].as<double>() > 0 && (!vm["lowLevelSolver"].as<bool>() || vm["portfolio"].as<int>() > 0 ||
+		vm["independenceDetection"].as<bool>() || vm.count("goals")))
+	{
+		cerr << "Large neighborhood search improves the plan of a single ECBS solver, without --portfolio, --independenceDetection or --goals!" << endl;
+		return -1;
+	}
+	if (vm["lnsReplan"].as<string>() != "PP" && vm["lnsReplan"].as<string>() != "CBS")
+	{
+		cerr << "Large neighborhood search replans by PP or CBS!" << endl;
+		return -1;
+	}
+
+	if (vm["highLevelSolver"].as<string>() == "PBS" && (vm["portfolio"].as<int>() > 0 || vm["independenceDetection"].as<bool>() ||
+		vm.count("goals") || vm["prioritizedPlanning"].as<int>() > 0 || vm["lns"].as<double>() > 0))
+	{
+		cerr << "PBS runs on its own, without --portfolio, --independenceDetection, --goals, --prioritizedPlanning or --lns!" << endl;
+		return -1;
+	}
+
+	high_level_solver_type s = high_level_solver_type::EES;
+	bool pbs = false; // priority-based search instead of CBS
 	if (vm["highLevelSolver"].as<string>() == "A*")
 		s = high_level_solver_type::ASTAR;
 	else if (vm["highLevelSolver"].as<string>() == "A*eps")
@@ -72,6 +227,8 @@ int main(int argc, char** argv)
 		s = high_level_solver_type::EES;
 	else if (vm["highLevelSolver"].as<string>() == "NEW")
 		s = high_level_solver_type::NEW;
+	else if (vm["highLevelSolver"].as<string>() == "PBS")
+		pbs = true;
 	else
 	{
 		cout << "WRONG high level solver!" << endl;
@@ -83,6 +240,14 @@ int main(int argc, char** argv)
 		cerr << "A* cannot perform suboptimal search!" << endl;
 		return -1;
 	}
+	if ((!vm["lowLevelSolver"].as<bool>() || pbs || s == high_level_solver_type::ASTAR) &&
+		(vm["anytime"].as<bool>() || vm["bestEffort"].as<bool>() || vm.count("checkpoint") ||
+		vm["mergeThreshold"].as<int>() > 0 || vm["hl-memory-mb"].as<int>() > 0 || vm["expansionBatch"].as<int>() > 1 ||
+		vm["parallelRoot"].as<bool>()))
+	{
+		cerr << "--anytime, --bestEffort, --checkpoint, --mergeThreshold, --hl-memory-mb, --expansionBatch and --parallelRoot are options of ECBS (--lowLevelSolver 1 with --highLevelSolver A*eps, EES or NEW)!" << endl;
+		return -1;
+	}
 
     heuristics_type h;
 	if (vm["heuristics"].as<string>() == "Zero")
@@ -140,14 +305,89 @@ int main(int argc, char** argv)
 	int runs = 1 + vm["restart"].as<int>();
 	//////////////////////////////////////////////////////////////////////
     // initialize the solver
+	if (pbs)
+	{
+		PBS solver(instance, vm["sipp"].as<bool>(), vm["screen"].as<int>());
+		solver.solve(vm["cutoffTime"].as<double>());
+		if (vm.count("output"))
+			solver.saveResults(vm["output"].as<string>(), vm["agents"].as<string>());
+		if (solver.solution_found && vm.count("outputPaths"))
+			solver.savePaths(vm["outputPaths"].as<string>());
+		return 0;
+	}
 	if (vm["lowLevelSolver"].as<bool>())
     {
         int success_trial = 0;
 		vector<float> all_runtimes;
-		for(int trial = 1; trial < 2; trial++){
-
-
-			ECBS ecbs(instance, vm["sipp"].as<bool>(), vm["screen"].as<int>());
+		if (vm["portfolio"].as<int>() > 0)
+		{
+			// race the configurations; the first one with a (validated) solution cancels the others
+			auto portfolio = getPortfolio(vm["portfolio"].as<int>(), s, h_hat, vm["bypass"].as<bool>());
+			vector<ECBS*> solvers;
+			for (const auto& member : portfolio)
+			{
+				solvers.push_back(new ECBS(instance, vm["sipp"].as<bool>(), vm["screen"].as<int>(),
+					solvers.empty() ? nullptr : solvers.front()));
+				auto ecbs = solvers.back();
+				ecbs->setPrioritizeConflicts(vm["prioritizingConflicts"].as<bool>());
+				ecbs->setDisjointSplitting(vm["disjointSplitting"].as<bool>());
+				ecbs->setBypass(member.bypass);
+				ecbs->setRectangleReasoning(vm["rectangleReasoning"].as<bool>());
+				ecbs->setCorridorReasoning(vm["corridorReasoning"].as<bool>());
+				ecbs->setHeuristicType(h, member.h_hat);
+				ecbs->setTargetReasoning(vm["targetReasoning"].as<bool>());
+				ecbs->setWindow(vm["window"].as<int>());
+				ecbs->setMutexReasoning(false);
+				ecbs->setConflictSelectionRule(conflict);
+				ecbs->setNodeSelectionRule(n);
+				ecbs->setSavingStats(vm["stats"].as<bool>());
+				ecbs->setHighLevelSolver(member.solver, vm["suboptimality"].as<double>());
+				ecbs->setMDDMemoryLimit(vm["mdd-memory-mb"].as<int>());
+				ecbs->setHLMemoryLimit(vm["hl-memory-mb"].as<int>());
+				ecbs->setNumOfThreads(vm["threads"].as<int>());
+				ecbs->setExpansionBatch(vm["expansionBatch"].as<int>());
+				ecbs->setParallelRoot(vm["parallelRoot"].as<bool>());
+				ecbs->randomRoot = member.random_root;
+				ecbs->setSeed(member.seed);
+				ecbs->portfolio_config = member.name;
+			}
+			std::atomic<bool> cancelled(false);
+			std::atomic<int> winner(-1);
+			auto race = [&](int i)
+			{
+				solvers[i]->setCancelFlag(&cancelled);
+				solvers[i]->solve(vm["cutoffTime"].as<double>());
+				int none = -1;
+				if (solvers[i]->solution_found && winner.compare_exchange_strong(none, i))
+					cancelled = true;
+			};
+			vector<std::thread> threads;
+			for (int i = 1; i < (int)solvers.size(); i++)
+				threads.emplace_back(race, i);
+			race(0);
+			for (auto& thread : threads)
+				thread.join();
+			for (int i = 0; i < (int)solvers.size(); i++)
+			{
+				solvers[i]->portfolio_win = (i == winner);
+				if (vm.count("output"))
+					solvers[i]->saveResults(vm["output"].as<string>(), vm["agents"].as<string>());
+			}
+			if (winner >= 0)
+			{
+				cout << "Portfolio winner: " << portfolio[winner].name << endl;
+				if (vm.count("outputPaths"))
+					solvers[winner]->savePaths(vm["outputPaths"].as<string>());
+			}
+			for (auto ecbs : solvers)
+			{
+				ecbs->clearSearchEngines();
+				delete ecbs;
+			}
+			return 0;
+		}
+		auto setUpECBS = [&](ECBS& ecbs)
+		{
 			ecbs.setPrioritizeConflicts(vm["prioritizingConflicts"].as<bool>());
 			ecbs.setDisjointSplitting(vm["disjointSplitting"].as<bool>());
 			ecbs.setBypass(vm["bypass"].as<bool>());
@@ -155,19 +395,111 @@ int main(int argc, char** argv)
 			ecbs.setCorridorReasoning(vm["corridorReasoning"].as<bool>());
 			ecbs.setHeuristicType(h, h_hat);
 			ecbs.setTargetReasoning(vm["targetReasoning"].as<bool>());
+			ecbs.setWindow(vm["window"].as<int>());
 			ecbs.setMutexReasoning(false);
 			ecbs.setConflictSelectionRule(conflict);
 			ecbs.setNodeSelectionRule(n);
 			ecbs.setSavingStats(vm["stats"].as<bool>());
 			ecbs.setHighLevelSolver(s, vm["suboptimality"].as<double>());
+			ecbs.setMDDMemoryLimit(vm["mdd-memory-mb"].as<int>());
+			ecbs.setHLMemoryLimit(vm["hl-memory-mb"].as<int>());
+			ecbs.setNumOfThreads(vm["threads"].as<int>());
+			ecbs.setExpansionBatch(vm["expansionBatch"].as<int>());
+			ecbs.setParallelRoot(vm["parallelRoot"].as<bool>());
+			ecbs.setMergeThreshold(vm["mergeThreshold"].as<int>());
+		};
+		if (vm["independenceDetection"].as<bool>())
+		{
+			IndependenceDetection id(instance, vm["sipp"].as<bool>(), vm["screen"].as<int>(), vm["threads"].as<int>(), setUpECBS);
+			id.solve(vm["cutoffTime"].as<double>());
+			if (vm.count("output"))
+				id.saveResults(vm["output"].as<string>(), vm["agents"].as<string>());
+			if (id.solution_found && vm.count("outputPaths"))
+				id.savePaths(vm["outputPaths"].as<string>());
+			return 0;
+		}
+		for(int trial = 1; trial < 2; trial++){
+
+
+			ECBS ecbs(instance, vm["sipp"].as<bool>(), vm["screen"].as<int>());
+			setUpECBS(ecbs);
+			ecbs.setAnytime(vm["anytime"].as<bool>());
+			ecbs.setBestEffort(vm["bestEffort"].as<bool>());
+			if (vm.count("checkpoint"))
+				ecbs.setCheckpoint(vm["checkpoint"].as<string>(), vm["checkpoint-interval"].as<double>(), vm["resume"].as<bool>());
+			if (vm["anytime"].as<bool>())
+			{
+				ecbs.setSolutionCallback([&]()
+				{
+					if (vm.count("output"))
+						ecbs.saveResults(vm["output"].as<string>(), vm["agents"].as<string>());
+					if (vm.count("outputPaths"))
+						ecbs.savePaths(vm["outputPaths"].as<string>());
+				});
+			}
+			if (vm.count("goals"))
+			{
+				ecbs.setHeuristicCacheLimit(vm["heuristic-cache-mb"].as<int>());
+				Lifelong lifelong(ecbs, instance, vm["replanInterval"].as<int>(), vm["screen"].as<int>());
+				if (!lifelong.loadGoals(vm["goals"].as<string>()))
+				{
+					cerr << "Cannot load goals from " << vm["goals"].as<string>() << endl;
+					return -1;
+				}
+				lifelong.run(vm["simulationTime"].as<int>(), vm["cutoffTime"].as<double>());
+				lifelong.printResults();
+				if (vm.count("output"))
+					lifelong.saveResults(vm["output"].as<string>(), vm["agents"].as<string>());
+				if (vm.count("outputPaths"))
+					lifelong.savePaths(vm["outputPaths"].as<string>());
+				ecbs.clearSearchEngines();
+				return 0;
+			}
+			// prioritized planning first, with the heuristic tables of ecbs
+			PrioritizedPlanning pp(ecbs, instance, vm["sipp"].as<bool>(), vm["screen"].as<int>(), vm["threads"].as<int>());
+			// large neighborhood search improves the plan of pp or ecbs, and its paths are saved instead
+			auto improve = [&](const auto& solver)
+			{
+				vector<Path> plan;
+				for (int i = 0; i < instance.getDefaultNumberOfAgents(); i++)
+					plan.push_back(solver.getPath(i));
+				LNS lns(ecbs, instance, vm["sipp"].as<bool>(), vm["screen"].as<int>(), vm["lnsNeighborSize"].as<int>(),
+					vm["lnsReplan"].as<string>() == "CBS");
+				lns.run(plan, vm["lns"].as<double>());
+				if (vm.count("lnsTrace"))
+					lns.saveTrace(vm["lnsTrace"].as<string>());
+				if (vm.count("outputPaths"))
+					lns.savePaths(vm["outputPaths"].as<string>());
+			};
+			double cutoff = vm["cutoffTime"].as<double>();
+			int lowerbound = 0;
+			int upperbound = MAX_COST;
+			if (vm["prioritizedPlanning"].as<int>() > 0)
+			{
+				pp.solve(cutoff, vm["prioritizedPlanning"].as<int>());
+				if (pp.solution_found && pp.solution_cost <= vm["suboptimality"].as<double>() * pp.lower_bound)
+				{
+					cout << "The prioritized planning plan is within the suboptimality bound" << endl;
+					if (vm.count("output"))
+						pp.saveResults(vm["output"].as<string>(), vm["agents"].as<string>());
+					if (vm.count("outputPaths"))
+						pp.savePaths(vm["outputPaths"].as<string>());
+					if (vm["lns"].as<double>() > 0)
+						improve(pp);
+					ecbs.clearSearchEngines();
+					return 0;
+				}
+				if (pp.solution_found)
+					upperbound = pp.solution_cost;
+				cutoff = max(0.0, cutoff - pp.runtime);
+			}
 			//////////////////////////////////////////////////////////////////////
 			// run
 			double runtime = 0;
-			int lowerbound = 0;
 			for (int i = 0; i < runs; i++)
 			{
 				ecbs.clear();
-				ecbs.solve(vm["cutoffTime"].as<double>() / runs, lowerbound);
+				ecbs.solve(cutoff / runs, lowerbound, upperbound);
 				runtime += ecbs.runtime;
 				if (ecbs.solution_found)
 					break;
@@ -182,8 +514,19 @@ int main(int argc, char** argv)
 			}
 			if (vm.count("output"))
 				ecbs.saveResults(vm["output"].as<string>(), vm["agents"].as<string>());
-			if (ecbs.solution_found && vm.count("outputPaths"))
+			// the prioritized planning plan is returned if ECBS stopped as it is within the bound, or if it is cheaper
+			bool pp_plan = pp.solution_found && (ecbs.solution_found ? pp.solution_cost < ecbs.solution_cost :
+				vm["suboptimality"].as<double>() * ecbs.getLowerBound() >= pp.solution_cost);
+			if (pp_plan)
+				cout << "Return the prioritized planning plan of cost " << pp.solution_cost << endl;
+			if (pp_plan && vm.count("outputPaths"))
+				pp.savePaths(vm["outputPaths"].as<string>());
+			else if ((ecbs.solution_found || ecbs.best_effort_plan) && vm.count("outputPaths"))
 				ecbs.savePaths(vm["outputPaths"].as<string>());
+			if (vm["lns"].as<double>() > 0 && (pp_plan || (pp.solution_found && !ecbs.solution_found)))
+				improve(pp); // even if it is not within the bound
+			else if (vm["lns"].as<double>() > 0 && ecbs.solution_found)
+				improve(ecbs);
 			/*size_t pos = vm["output"].as<string>().rfind('.');      // position of the file extension
 			string output_name = vm["output"].as<string>().substr(0, pos);     // get the name without extension
 			cbs.saveCT(output_name); // for debug*/
@@ -219,11 +562,14 @@ int main(int argc, char** argv)
 			cbs.setCorridorReasoning(vm["corridorReasoning"].as<bool>());
 			cbs.setHeuristicType(h, h_hat);
 			cbs.setTargetReasoning(vm["targetReasoning"].as<bool>());
+			cbs.setWindow(vm["window"].as<int>());
 			cbs.setMutexReasoning(false);
 			cbs.setConflictSelectionRule(conflict);
 			cbs.setNodeSelectionRule(n);
 			cbs.setSavingStats(vm["stats"].as<bool>());
 			cbs.setHighLevelSolver(s, vm["suboptimality"].as<double>());
+			cbs.setMDDMemoryLimit(vm["mdd-memory-mb"].as<int>());
+			cbs.setNumOfThreads(vm["threads"].as<int>());
 			//////////////////////////////////////////////////////////////////////
 			// run
 			double runtime = 0;